@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Processor.h>
+#include <tulips/stack/ipv4/Producer.h>
+#include <tulips/stack/ipv4/Processor.h>
+#include <tulips/stack/ethernet/Producer.h>
+#include <tulips/stack/ethernet/Processor.h>
+#include <tulips/system/Clock.h>
+#include <tulips/system/Compiler.h>
+#include <tulips/transport/list/Device.h>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <tclap/CmdLine.h>
+
+using namespace tulips;
+using namespace stack;
+
+namespace {
+
+class Handler : public tcpv4::EventHandler
+{
+public:
+  void onConnected(UNUSED tcpv4::Connection& c) override {}
+
+  void onAborted(UNUSED tcpv4::Connection& c) override {}
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override {}
+
+  void onSent(UNUSED tcpv4::Connection& c) override {}
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len, UNUSED const uint32_t alen,
+                   UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override {}
+};
+
+/*
+ * A complete Ethernet/IPv4/TCPv4 stack on top of a device.
+ */
+struct Stack
+{
+  Stack(transport::Device& dev, ipv4::Address const& ip4,
+        ipv4::Address const& bcast, ipv4::Address const& nmask,
+        const size_t nconn)
+    : evt()
+    , eth_prod(dev, dev.address())
+    , ip4_prod(eth_prod, ip4)
+    , eth_proc(dev.address())
+    , ip4_proc(ip4)
+    , tcp(dev, eth_prod, ip4_prod, evt, nconn)
+  {
+    tcp.setEthernetProcessor(eth_proc).setIPv4Processor(ip4_proc);
+    ip4_prod.setDefaultRouterAddress(bcast).setNetMask(nmask);
+    ip4_proc.setEthernetProcessor(eth_proc).setTCPv4Processor(tcp);
+    eth_proc.setIPv4Processor(ip4_proc);
+  }
+
+  Handler evt;
+  ethernet::Producer eth_prod;
+  ipv4::Producer ip4_prod;
+  ethernet::Processor eth_proc;
+  ipv4::Processor ip4_proc;
+  tcpv4::Processor tcp;
+};
+
+/*
+ * Open nconn half-open connections on a server of size connections and return
+ * the average number of cycles spent processing a SYN.
+ */
+system::Clock::Value
+accept(const size_t size, const size_t nconn)
+{
+  ethernet::Address cadr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10);
+  ethernet::Address sadr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20);
+  ipv4::Address bcast(10, 1, 0, 254);
+  ipv4::Address nmask(255, 255, 255, 0);
+  ipv4::Address cip4(10, 1, 0, 1);
+  ipv4::Address sip4(10, 1, 0, 2);
+  transport::list::Device::List clist;
+  transport::list::Device::List slist;
+  /*
+   * Build the devices and the stacks.
+   */
+  transport::list::Device client(cadr, cip4, bcast, nmask, 1514, slist, clist);
+  transport::list::Device server(sadr, sip4, bcast, nmask, 1514, clist, slist);
+  Stack cstack(client, cip4, bcast, nmask, size);
+  Stack sstack(server, sip4, bcast, nmask, size);
+  sstack.tcp.listen(1234);
+  /*
+   * Open the connections. The SYN/ACKs are dropped so that the server-side
+   * connections all stay in SYN_RCVD.
+   */
+  system::Clock::Value total = 0;
+  for (size_t i = 0; i < nconn; i += 1) {
+    tcpv4::Connection::ID c;
+    if (cstack.tcp.connect(sadr, sip4, 1234, c) != Status::Ok) {
+      return 0;
+    }
+    system::Clock::Value start = system::Clock::read();
+    if (server.poll(sstack.eth_proc) != Status::Ok) {
+      return 0;
+    }
+    total += system::Clock::read() - start;
+    client.drop();
+  }
+  return total / nconn;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  TCLAP::CmdLine cmd("TULIPS Accept Benchmark", ' ', "1.0");
+  TCLAP::ValueArg<size_t> count("n", "count", "Number of connections", false,
+                                8192, "COUNT", cmd);
+  TCLAP::ValueArg<size_t> rounds("r", "rounds", "Number of rounds per count",
+                                 false, 16, "ROUNDS", cmd);
+  cmd.parse(argc, argv);
+  /*
+   * Time the processing of a SYN for a growing number of open connections. The
+   * size of the connection table does not change, so that its footprint in the
+   * caches does not either: as the allocation of a connection is in constant
+   * time, the cost per SYN should not depend on the number of connections.
+   * Report the best of the rounds to filter out the noise.
+   */
+  std::cout << std::setw(8) << "nconn" << std::setw(16) << "cycles/accept"
+            << std::endl;
+  for (size_t nconn = 16; nconn <= count.getValue(); nconn <<= 1) {
+    system::Clock::Value best = 0;
+    for (size_t i = 0; i < rounds.getValue(); i += 1) {
+      system::Clock::Value cycles = accept(count.getValue(), nconn);
+      if (cycles == 0) {
+        std::cerr << "failed to open " << nconn << " connections" << std::endl;
+        return 1;
+      }
+      best = best == 0 || cycles < best ? cycles : best;
+    }
+    std::cout << std::setw(8) << nconn << std::setw(16) << best << std::endl;
+  }
+  return 0;
+}
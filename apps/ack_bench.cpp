@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Processor.h>
+#include <tulips/stack/ipv4/Producer.h>
+#include <tulips/stack/ipv4/Processor.h>
+#include <tulips/stack/ethernet/Producer.h>
+#include <tulips/stack/ethernet/Processor.h>
+#include <tulips/system/Clock.h>
+#include <tulips/system/Compiler.h>
+#include <tulips/transport/list/Device.h>
+#include <cstdint>
+#include <iostream>
+#include <tclap/CmdLine.h>
+
+using namespace tulips;
+using namespace stack;
+
+namespace {
+
+class Handler : public tcpv4::EventHandler
+{
+public:
+  void onConnected(UNUSED tcpv4::Connection& c) override {}
+
+  void onAborted(UNUSED tcpv4::Connection& c) override {}
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override {}
+
+  void onSent(UNUSED tcpv4::Connection& c) override {}
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len, UNUSED const uint32_t alen,
+                   UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override {}
+};
+
+/*
+ * A complete Ethernet/IPv4/TCPv4 stack on top of a device.
+ */
+struct Stack
+{
+  Stack(transport::Device& dev, ipv4::Address const& ip4,
+        ipv4::Address const& bcast, ipv4::Address const& nmask,
+        const size_t nconn)
+    : evt()
+    , eth_prod(dev, dev.address())
+    , ip4_prod(eth_prod, ip4)
+    , eth_proc(dev.address())
+    , ip4_proc(ip4)
+    , tcp(dev, eth_prod, ip4_prod, evt, nconn)
+  {
+    tcp.setEthernetProcessor(eth_proc).setIPv4Processor(ip4_proc);
+    ip4_prod.setDefaultRouterAddress(bcast).setNetMask(nmask);
+    ip4_proc.setEthernetProcessor(eth_proc).setTCPv4Processor(tcp);
+    eth_proc.setIPv4Processor(ip4_proc);
+  }
+
+  Handler evt;
+  ethernet::Producer eth_prod;
+  ipv4::Producer ip4_prod;
+  ethernet::Processor eth_proc;
+  ipv4::Processor ip4_proc;
+  tcpv4::Processor tcp;
+};
+
+/*
+ * Fill the segment ring of the client rounds times, have the server
+ * acknowledge every segment, and return the average number of cycles spent
+ * by the client processing an ACK.
+ */
+system::Clock::Value
+ack(const size_t rounds)
+{
+  ethernet::Address cadr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10);
+  ethernet::Address sadr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20);
+  ipv4::Address bcast(10, 1, 0, 254);
+  ipv4::Address nmask(255, 255, 255, 0);
+  ipv4::Address cip4(10, 1, 0, 1);
+  ipv4::Address sip4(10, 1, 0, 2);
+  transport::list::Device::List clist;
+  transport::list::Device::List slist;
+  /*
+   * Build the devices and the stacks.
+   */
+  transport::list::Device client(cadr, cip4, bcast, nmask, 1514, slist, clist);
+  transport::list::Device server(sadr, sip4, bcast, nmask, 1514, clist, slist);
+  Stack cstack(client, cip4, bcast, nmask, 1);
+  Stack sstack(server, sip4, bcast, nmask, 1);
+  sstack.tcp.listen(1234);
+  /*
+   * Connect the client.
+   */
+  tcpv4::Connection::ID c;
+  if (cstack.tcp.connect(sadr, sip4, 1234, c) != Status::Ok ||
+      server.poll(sstack.eth_proc) != Status::Ok ||
+      client.poll(cstack.eth_proc) != Status::Ok ||
+      server.poll(sstack.eth_proc) != Status::Ok) {
+    return 0;
+  }
+  /*
+   * Time the processing of the ACKs, including Ethernet and IPv4.
+   */
+  uint64_t pld = 0xdeadbeefULL;
+  system::Clock::Value total = 0;
+  size_t acks = 0;
+  for (size_t i = 0; i < rounds; i += 1) {
+    uint32_t off = 0;
+    while (cstack.tcp.send(c, 8, (uint8_t*)&pld, off) == Status::Ok) {
+      off = 0;
+    }
+    while (!clist.empty()) {
+      if (server.poll(sstack.eth_proc) != Status::Ok) {
+        return 0;
+      }
+    }
+    while (!slist.empty()) {
+      system::Clock::Value start = system::Clock::read();
+      if (client.poll(cstack.eth_proc) != Status::Ok) {
+        return 0;
+      }
+      total += system::Clock::read() - start;
+      acks += 1;
+    }
+  }
+  return acks == 0 ? 0 : total / acks;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  TCLAP::CmdLine cmd("TULIPS ACK Benchmark", ' ', "1.0");
+  TCLAP::ValueArg<size_t> rounds("r", "rounds", "Number of rounds per run",
+                                 false, 10000, "ROUNDS", cmd);
+  TCLAP::ValueArg<size_t> runs("n", "runs", "Number of runs", false, 8, "RUNS",
+                               cmd);
+  cmd.parse(argc, argv);
+  /*
+   * Time the processing of an ACK that acknowledges a single segment. Report
+   * the best of the runs to filter out the noise.
+   */
+  system::Clock::Value best = 0;
+  for (size_t i = 0; i < runs.getValue(); i += 1) {
+    system::Clock::Value cycles = ack(rounds.getValue());
+    if (cycles == 0) {
+      std::cerr << "failed to run the benchmark" << std::endl;
+      return 1;
+    }
+    best = best == 0 || cycles < best ? cycles : best;
+  }
+  std::cout << "cycles per ACK: " << best << std::endl;
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tulips/stack/Utils.h>
+#include <tulips/system/Clock.h>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <tclap/CmdLine.h>
+
+using namespace tulips;
+using namespace stack;
+
+/*
+ * Sizes of the buffers, from 64B to 64KB.
+ */
+static const uint16_t SIZES[] = { 64,   128,  256,   512,   1024, 1500,
+                                  2048, 4096, 9000, 16384, 32768, 65535 };
+
+int
+main(int argc, char** argv)
+{
+  TCLAP::CmdLine cmd("TULIPS Checksum Benchmark", ' ', "1.0");
+  TCLAP::ValueArg<size_t> bytes("b", "bytes", "Bytes to sum per run", false,
+                                1ULL << 30, "BYTES", cmd);
+  cmd.parse(argc, argv);
+  /*
+   * Fill the buffer.
+   */
+  std::vector<uint8_t> data(65535);
+  for (size_t i = 0; i < data.size(); i += 1) {
+    data[i] = i * 2654435761ULL >> 24;
+  }
+  /*
+   * Run all the kernels supported by the CPU over all sizes.
+   */
+  auto kernels = utils::checksumKernels();
+  std::cout << "Selected kernel: " << kernels.back().name << std::endl;
+  std::cout << std::setw(8) << "size";
+  for (auto const& k : kernels) {
+    std::cout << std::setw(16) << k.name;
+  }
+  std::cout << "  (ns/call, GB/s)" << std::endl;
+  uint16_t sink = 0;
+  for (uint16_t len : SIZES) {
+    size_t iters = bytes.getValue() / len + 1;
+    std::cout << std::setw(8) << len;
+    for (auto const& k : kernels) {
+      auto start = system::Clock::read();
+      for (size_t i = 0; i < iters; i += 1) {
+        sink = k.function(sink, data.data(), len);
+      }
+      auto ns = system::Clock::nanosecondsOf(system::Clock::read() - start);
+      double call = (double)ns / iters;
+      std::cout << std::setw(8) << std::fixed << std::setprecision(1) << call
+                << std::setw(8) << std::setprecision(2) << len / call;
+    }
+    std::cout << std::endl;
+  }
+  /*
+   * Print the sink so that the sums are not optimized out.
+   */
+  std::cout << "Sink: 0x" << std::hex << sink << std::dec << std::endl;
+  return 0;
+}
@@ -61,6 +61,8 @@ public:
 
   Status run() override { return Status::Ok; }
 
+  using Processor::process;
+
   Status process(UNUSED const uint16_t len, const uint8_t* const data) override
   {
     uint64_t value = *(uint64_t*)data;
@@ -63,6 +63,12 @@ public:
     return m_ethfrom.process(len, data);
   }
 
+  inline Status process(const uint16_t count,
+                        const transport::Frame* const frames) override
+  {
+    return m_ethfrom.process(count, frames);
+  }
+
   /**
    * Client interface.
    */
@@ -81,6 +87,13 @@ public:
   Status send(const ID id, const uint32_t len, const uint8_t* const data,
               uint32_t& off) override;
 
+  Status sendv(const ID id, const struct iovec* const iov, const size_t count,
+               uint32_t& off) override;
+
+  Status setReceiveBuffer(const ID id, const uint32_t len) override;
+
+  Status consume(const ID id, const uint32_t len) override;
+
   system::Clock::Value averageLatency(const ID id) override;
 
   /**
@@ -140,6 +153,8 @@ private:
   public:
     Status run() override { return Status::Ok; }
 
+    using Processor::process;
+
     Status process(UNUSED const uint16_t len,
                    UNUSED const uint8_t* const data) override
     {
@@ -166,6 +181,15 @@ private:
                    const uint32_t len, const uint32_t alen,
                    uint8_t* const sdata, uint32_t& slen) override;
 
+  Action onNewData(stack::tcpv4::Connection& c,
+                   const transport::Frame* const frags,
+                   const size_t count) override;
+
+  Action onNewData(stack::tcpv4::Connection& c,
+                   const transport::Frame* const frags, const size_t count,
+                   const uint32_t alen, uint8_t* const sdata,
+                   uint32_t& slen) override;
+
   Delegate& m_delegate;
   transport::Device& m_dev;
   size_t m_nconn;
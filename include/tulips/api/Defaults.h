@@ -35,8 +35,10 @@ namespace tulips { namespace defaults {
 class ClientDelegate : public Client::Delegate
 {
 public:
+  using Client::Delegate::onNewData;
+
   void* onConnected(Client::ID const& id, void* const cookie,
-                    uint8_t& opts) override;
+                    uint16_t& opts) override;
 
   Action onAcked(Client::ID const& id, void* const cookie) override;
 
@@ -57,8 +59,10 @@ public:
 class ServerDelegate : public Server::Delegate
 {
 public:
+  using Server::Delegate::onNewData;
+
   void* onConnected(Server::ID const& id, void* const cookie,
-                    uint8_t& opts) override;
+                    uint16_t& opts) override;
 
   Action onAcked(Server::ID const& id, void* const cookie) override;
 
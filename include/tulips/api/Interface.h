@@ -34,6 +34,7 @@
 #include <tulips/system/Clock.h>
 #include <tulips/transport/Device.h>
 #include <cstdint>
+#include <sys/uio.h>
 
 namespace tulips { namespace interface {
 
@@ -58,7 +59,7 @@ struct Delegate
    * @return a user-defined state for the connection.
    */
   virtual void* onConnected(ID const& id, void* const cookie,
-                            uint8_t& opts) = 0;
+                            uint16_t& opts) = 0;
 
   /**
    * Callback when a packet has been acked. The delegate is not permitted
@@ -119,6 +120,63 @@ struct Delegate
                            const uint32_t alen, uint8_t* const sdata,
                            uint32_t& slen) = 0;
 
+  /**
+   * Callback when coalesced new data has been received, as a list of
+   * fragments. The delegate is not permitted to send a response. By default,
+   * the fragments are delivered one at a time.
+   *
+   * @param id the connection's handle.
+   * @param cookie the connection's user-defined state.
+   * @param frags the received fragments.
+   * @param count the number of fragments.
+   *
+   * @return an action to be taken upon completion of the callback.
+   */
+  virtual Action onNewData(ID const& id, void* const cookie,
+                           const transport::Frame* const frags,
+                           const size_t count)
+  {
+    for (size_t i = 0; i < count; i += 1) {
+      Action act = onNewData(id, cookie, frags[i].data, frags[i].len);
+      if (act != Action::Continue) {
+        return act;
+      }
+    }
+    return Action::Continue;
+  }
+
+  /**
+   * Callback when coalesced new data has been received, as a list of
+   * fragments. The delegate is permitted to send a response. By default, the
+   * fragments are delivered one at a time.
+   *
+   * @param id the connection's handle.
+   * @param cookie the connection's user-defined state.
+   * @param frags the received fragments.
+   * @param count the number of fragments.
+   * @param alen the amount of data available in the response frame.
+   * @param sdata a pointer to the response area in the frame.
+   * @param slen the effective size of the response data written.
+   *
+   * @return an action to be taken upon completion of the callback.
+   */
+  virtual Action onNewData(ID const& id, void* const cookie,
+                           const transport::Frame* const frags,
+                           const size_t count, const uint32_t alen,
+                           uint8_t* const sdata, uint32_t& slen)
+  {
+    for (size_t i = 0; i < count; i += 1) {
+      uint32_t rlen = 0;
+      Action act = onNewData(id, cookie, frags[i].data, frags[i].len,
+                             alen - slen, sdata + slen, rlen);
+      slen += rlen;
+      if (act != Action::Continue) {
+        return act;
+      }
+    }
+    return Action::Continue;
+  }
+
   /*
    * Callback when a connection is closed.
    *
@@ -201,6 +259,42 @@ public:
   virtual Status send(const ID id, const uint32_t len,
                       const uint8_t* const data, uint32_t& off) = 0;
 
+  /**
+   * Send data gathered from multiple fragments through a connection. May send
+   * partial data.
+   *
+   * @param id the connection's handle.
+   * @param iov the fragments.
+   * @param count the number of fragments.
+   * @param off the amount of data actually written, across all fragments.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status sendv(const ID id, const struct iovec* const iov,
+                       const size_t count, uint32_t& off) = 0;
+
+  /**
+   * Defer the consumption of the data received on a connection. The window
+   * advertised to the peer is then the space left in a receive buffer, which
+   * the application frees by reporting the data it consumed with consume().
+   *
+   * @param id the connection's handle.
+   * @param len the size of the receive buffer.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status setReceiveBuffer(const ID id, const uint32_t len) = 0;
+
+  /**
+   * Report received data as consumed by the application.
+   *
+   * @param id the connection's handle.
+   * @param len the amount of data consumed.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status consume(const ID id, const uint32_t len) = 0;
+
   /**
    * Get average latency for a connection.
    *
@@ -266,6 +360,42 @@ public:
    */
   virtual Status send(const ID id, const uint32_t len,
                       const uint8_t* const data, uint32_t& off) = 0;
+
+  /**
+   * Send data gathered from multiple fragments through a connection. May send
+   * partial data.
+   *
+   * @param id the connection's handle.
+   * @param iov the fragments.
+   * @param count the number of fragments.
+   * @param off the amount of data actually written, across all fragments.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status sendv(const ID id, const struct iovec* const iov,
+                       const size_t count, uint32_t& off) = 0;
+
+  /**
+   * Defer the consumption of the data received on a connection. The window
+   * advertised to the peer is then the space left in a receive buffer, which
+   * the application frees by reporting the data it consumed with consume().
+   *
+   * @param id the connection's handle.
+   * @param len the size of the receive buffer.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status setReceiveBuffer(const ID id, const uint32_t len) = 0;
+
+  /**
+   * Report received data as consumed by the application.
+   *
+   * @param id the connection's handle.
+   * @param len the amount of data consumed.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status consume(const ID id, const uint32_t len) = 0;
 };
 
 }}
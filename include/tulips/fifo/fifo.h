@@ -126,6 +126,22 @@ tulips_fifo_front(tulips_fifo_t const fifo, void** const data)
   return TULIPS_FIFO_OK;
 }
 
+static inline tulips_fifo_error_t
+tulips_fifo_peek(tulips_fifo_t const fifo, const size_t n, void** const data)
+{
+#ifdef TULIPS_FIFO_RUNTIME_CHECKS
+  if (fifo == TULIPS_FIFO_DEFAULT_VALUE) {
+    return TULIPS_FIFO_IS_NULL;
+  }
+#endif
+  if (fifo->write_count - fifo->read_count <= n) {
+    return TULIPS_FIFO_EMPTY;
+  }
+  size_t index = (fifo->read_count + n) % fifo->depth;
+  *data = fifo->data + index * fifo->data_len;
+  return TULIPS_FIFO_OK;
+}
+
 static inline tulips_fifo_error_t
 tulips_fifo_push(tulips_fifo_t const fifo, const void* restrict const data)
 {
@@ -55,6 +55,12 @@ public:
     return m_client.process(len, data);
   }
 
+  inline Status process(const uint16_t count,
+                        const transport::Frame* const frames) override
+  {
+    return m_client.process(count, frames);
+  }
+
   /**
    * Client interface.
    */
@@ -73,13 +79,20 @@ public:
   Status send(const ID id, const uint32_t len, const uint8_t* const data,
               uint32_t& off) override;
 
+  Status sendv(const ID id, const struct iovec* const iov, const size_t count,
+               uint32_t& off) override;
+
+  Status setReceiveBuffer(const ID id, const uint32_t len) override;
+
+  Status consume(const ID id, const uint32_t len) override;
+
   system::Clock::Value averageLatency(const ID id) override;
 
   /*
    * Client delegate.
    */
 
-  void* onConnected(ID const& id, void* const cookie, uint8_t& opts) override;
+  void* onConnected(ID const& id, void* const cookie, uint16_t& opts) override;
 
   Action onAcked(ID const& id, void* const cookie) override;
 
@@ -93,6 +106,15 @@ public:
                    const uint32_t len, const uint32_t alen,
                    uint8_t* const sdata, uint32_t& slen) override;
 
+  Action onNewData(ID const& id, void* const cookie,
+                   const transport::Frame* const frags,
+                   const size_t count) override;
+
+  Action onNewData(ID const& id, void* const cookie,
+                   const transport::Frame* const frags, const size_t count,
+                   const uint32_t alen, uint8_t* const sdata,
+                   uint32_t& slen) override;
+
   void onClosed(ID const& id, void* const cookie) override;
 
 private:
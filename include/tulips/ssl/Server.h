@@ -50,6 +50,12 @@ public:
     return m_server.process(len, data);
   }
 
+  inline Status process(const uint16_t count,
+                        const transport::Frame* const frames) override
+  {
+    return m_server.process(count, frames);
+  }
+
   Status close(const ID id) override;
 
   bool isClosed(const ID id) const override;
@@ -57,6 +63,13 @@ public:
   Status send(const ID id, const uint32_t len, const uint8_t* const data,
               uint32_t& off) override;
 
+  Status sendv(const ID id, const struct iovec* const iov, const size_t count,
+               uint32_t& off) override;
+
+  Status setReceiveBuffer(const ID id, const uint32_t len) override;
+
+  Status consume(const ID id, const uint32_t len) override;
+
   inline void listen(const stack::tcpv4::Port port, void* cookie) override
   {
     m_server.listen(port, cookie);
@@ -67,7 +80,7 @@ public:
     m_server.unlisten(port);
   }
 
-  void* onConnected(ID const& id, void* const cookie, uint8_t& opts) override;
+  void* onConnected(ID const& id, void* const cookie, uint16_t& opts) override;
 
   Action onAcked(ID const& id, void* const cookie) override;
 
@@ -81,6 +94,15 @@ public:
                    const uint32_t len, const uint32_t alen,
                    uint8_t* const sdata, uint32_t& slen) override;
 
+  Action onNewData(ID const& id, void* const cookie,
+                   const transport::Frame* const frags,
+                   const size_t count) override;
+
+  Action onNewData(ID const& id, void* const cookie,
+                   const transport::Frame* const frags, const size_t count,
+                   const uint32_t alen, uint8_t* const sdata,
+                   uint32_t& slen) override;
+
   void onClosed(ID const& id, void* const cookie) override;
 
 private:
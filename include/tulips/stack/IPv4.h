@@ -105,6 +105,14 @@ static constexpr uint8_t USED PROTO_ICMP = 1;
 static constexpr uint8_t USED PROTO_TCP = 6;
 static constexpr uint8_t USED PROTO_TEST = 254;
 
+/*
+ * ECN codepoints of the type of service field (RFC 3168).
+ */
+static constexpr uint8_t USED ECN_NOT_ECT = 0x0;
+static constexpr uint8_t USED ECN_ECT0 = 0x2;
+static constexpr uint8_t USED ECN_CE = 0x3;
+static constexpr uint8_t USED ECN_MASK = 0x3;
+
 /*
  * The IPv4 checksum.
  */
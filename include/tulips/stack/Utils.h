@@ -31,12 +31,36 @@
 #include <iomanip>
 #include <limits>
 #include <ostream>
+#include <vector>
 
 namespace tulips { namespace stack { namespace utils {
 
+/*
+ * Internet checksum of a buffer, added to a seed, in host byte order. The
+ * best kernel supported by the CPU is selected on the first call.
+ */
 uint16_t checksum(const uint16_t seed, const uint8_t* const data,
                   const uint16_t len);
 
+/*
+ * Kernels of the Internet checksum. The scalar kernel sums one 16-bit word at
+ * a time and is the reference of the others.
+ */
+struct ChecksumKernel
+{
+  using Function = uint16_t (*)(const uint16_t, const uint8_t* const,
+                                const uint16_t);
+
+  const char* name;
+  Function function;
+};
+
+/*
+ * Kernels supported by the CPU, from the reference to the one used by
+ * checksum().
+ */
+std::vector<ChecksumKernel> checksumKernels();
+
 void hexdump(const uint8_t* const data, const uint16_t len, std::ostream& out);
 
 bool headerLength(const uint8_t* const packet, const uint32_t plen,
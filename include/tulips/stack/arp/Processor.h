@@ -43,6 +43,7 @@ public:
   Processor(ethernet::Producer& eth, ipv4::Producer& ip4);
 
   Status run() override;
+  using transport::Processor::process;
   Status process(const uint16_t len, const uint8_t* const data) override;
 
   bool has(ipv4::Address const& destipaddr);
@@ -52,6 +52,8 @@ public:
 
   Status run() override;
   Status process(const uint16_t len, const uint8_t* const data) override;
+  Status process(const uint16_t count,
+                 const transport::Frame* const frames) override;
 
   Address const& sourceAddress() { return m_srceAddress; }
 
@@ -46,6 +46,21 @@ public:
   Status prepare(uint8_t*& buf) override;
   Status commit(const uint32_t len, uint8_t* const buf,
                 const uint16_t mss = 0) override;
+  Status commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                 const transport::Frame* const frags,
+                 const uint16_t mss = 0) override;
+
+  /*
+   * Prepare a buffer from a template of the headers of the frame, written by
+   * header() and possibly followed by the headers of the upper layers.
+   */
+  Status prepare(uint8_t*& buf, const uint8_t* const hdr, const uint16_t len);
+
+  /*
+   * Write the header of the frames sent to a destination address.
+   */
+  void header(Address const& dst, const uint16_t type,
+              uint8_t* const buf) const;
 
   Address const& hostAddress() { return m_hostAddress; }
 
@@ -44,6 +44,7 @@ public:
   Processor(ethernet::Producer& eth, ipv4::Producer& ip4);
 
   Status run() override { return Status::Ok; }
+  using transport::Processor::process;
   Status process(const uint16_t len, const uint8_t* const data) override;
 
   Request& attach(ethernet::Producer& eth, ipv4::Producer& ip4);
@@ -64,7 +64,10 @@ public:
   Processor(Address const& ha);
 
   Status run() override;
+  using transport::Processor::process;
   Status process(const uint16_t len, const uint8_t* const data) override;
+  void begin();
+  Status flush();
 
   Address const& sourceAddress() const { return m_srceAddress; }
 
@@ -72,6 +75,8 @@ public:
 
   uint8_t protocol() const { return m_proto; }
 
+  uint8_t typeOfService() const { return m_tos; }
+
   Processor& setEthernetProcessor(ethernet::Processor& eth)
   {
     m_eth = &eth;
@@ -105,6 +110,7 @@ private:
   Address m_srceAddress;
   Address m_destAddress;
   uint8_t m_proto;
+  uint8_t m_tos;
   Statistics m_stats;
   ethernet::Processor* m_eth;
 #ifdef TULIPS_ENABLE_RAW
@@ -50,6 +50,23 @@ public:
   Status prepare(uint8_t*& buf) override;
   Status commit(const uint32_t len, uint8_t* const buf,
                 const uint16_t mss = 0) override;
+  Status commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                 const transport::Frame* const frags,
+                 const uint16_t mss = 0) override;
+
+  /*
+   * Prepare a buffer from a template of the Ethernet and IPv4 headers of the
+   * packet, written by header() and possibly followed by the headers of the
+   * upper layers. Only the identification and the type of service are set.
+   */
+  Status prepare(uint8_t*& buf, const uint8_t* const hdr, const uint16_t len,
+                 const uint8_t tos);
+
+  /*
+   * Write the Ethernet and IPv4 headers of the packets sent to a destination.
+   */
+  void header(ethernet::Address const& hwdst, Address const& dst,
+              const uint8_t proto, uint8_t* const buf) const;
 
   Address const& hostAddress() const { return m_hostAddress; }
 
@@ -77,6 +94,8 @@ public:
 
   void setProtocol(const uint8_t proto) { m_proto = proto; }
 
+  void setTypeOfService(const uint8_t tos) { m_tos = tos; }
+
   bool isLocal(Address const& addr) const
   {
     return (addr.m_data & m_netMask.m_data) ==
@@ -90,6 +109,7 @@ private:
   Address m_defaultRouterAddress;
   Address m_netMask;
   uint8_t m_proto;
+  uint8_t m_tos;
   uint16_t m_ipid;
   Statistics m_stats;
 };
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <tulips/system/Clock.h>
+#include <cstdint>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Congestion control state of a connection. Windows are expressed in bytes.
+ * The algorithm is chosen by the caller on each event, so that it can be
+ * changed during the lifetime of the connection. The state is not updated
+ * when congestion control is disabled (NONE).
+ *
+ * - NEWRENO: slow start and congestion avoidance with appropriate byte
+ *   counting (RFC 5681, RFC 3465) and NewReno loss recovery (RFC 6582).
+ * - CUBIC: window growth as a cubic function of the time since the last
+ *   congestion event, with a Reno-friendly lower bound (RFC 9438).
+ * - DCTCP: NewReno, with a window reduction proportional to the fraction of
+ *   CE-marked bytes when the peer echoes ECN marks (RFC 8257).
+ */
+class Congestion
+{
+public:
+  enum Algorithm
+  {
+    NONE = 0,
+    NEWRENO = 1,
+    CUBIC = 2,
+    DCTCP = 3
+  };
+
+  Congestion();
+
+  /*
+   * Reset the state of a new connection, with the initial window of RFC 6928.
+   */
+  void reset(const uint16_t mss, const uint32_t snd_nxt);
+
+  inline uint32_t window() const { return m_cwnd; }
+
+  inline uint32_t threshold() const { return m_ssthresh; }
+
+  /*
+   * New data was acknowledged outside of a loss recovery, while the window was
+   * fully used. The RTT is the smoothed RTT in clock cycles.
+   */
+  void onAck(const Algorithm algo, const uint16_t mss, const uint32_t acked,
+             const system::Clock::Value rtt, const system::Clock::Value now);
+
+  /*
+   * ECN feedback for DCTCP, for each ACK of new data.
+   */
+  void onEcn(const uint16_t mss, const uint32_t acked, const bool ece,
+             const uint32_t ackno, const uint32_t snd_nxt);
+
+  /*
+   * A loss was detected by duplicate ACKs.
+   */
+  void onLoss(const Algorithm algo, const uint16_t mss, const uint32_t flight);
+
+  /*
+   * The retransmission timer expired.
+   */
+  void onTimeout(const Algorithm algo, const uint16_t mss,
+                 const uint32_t flight);
+
+private:
+  /*
+   * CUBIC constants: C = 0.4 and beta = 0.7, scaled by 2^10, and the additive
+   * increase factor of the Reno-friendly region, 3 * (1 - beta) / (1 + beta).
+   */
+  static constexpr uint64_t CUBIC_C = 410;
+  static constexpr uint64_t CUBIC_BETA = 717;
+  static constexpr uint64_t CUBIC_ALPHA = 542;
+
+  /*
+   * DCTCP alpha is scaled by 2^10, its gain g is 1/2^4.
+   */
+  static constexpr uint32_t DCTCP_ALPHA_MAX = 1 << 10;
+  static constexpr uint32_t DCTCP_G_SHIFT = 4;
+
+  void reduce(const Algorithm algo, const uint16_t mss, const uint32_t flight);
+  void increaseCubic(const uint16_t mss, const uint32_t acked,
+                     const system::Clock::Value rtt,
+                     const system::Clock::Value now);
+
+  system::Clock::Value m_epoch; // 8 - CUBIC, start of the current epoch
+  uint32_t m_cwnd;              // 4 - Congestion window
+  uint32_t m_ssthresh;          // 4 - Slow start threshold
+  uint32_t m_acked;             // 4 - Bytes acknowledged since last increase
+  uint32_t m_wmax;              // 4 - CUBIC, window before the last reduction
+  uint32_t m_origin;            // 4 - CUBIC, origin point of the cubic curve
+  uint32_t m_k;                 // 4 - CUBIC, time to reach the origin point
+  uint32_t m_west;              // 4 - CUBIC, Reno-friendly window estimate
+  uint32_t m_alpha;             // 4 - DCTCP, estimated fraction of CE marks
+  uint32_t m_ackbytes;          // 4 - DCTCP, bytes acknowledged in the window
+  uint32_t m_cebytes;           // 4 - DCTCP, bytes marked in the window
+  uint32_t m_wndend;            // 4 - DCTCP, end of the observation window
+  bool m_cwr;                   // 1 - DCTCP, window reduced in this window
+};
+
+static_assert(sizeof(Congestion) == 56, "Invalid size for tcpv4::Congestion");
+
+}}}
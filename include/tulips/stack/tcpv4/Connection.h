@@ -28,6 +28,7 @@
 #pragma once
 
 #include <tulips/stack/TCPv4.h>
+#include <tulips/stack/tcpv4/Congestion.h>
 #include <tulips/stack/ethernet/Producer.h>
 #include <tulips/stack/ipv4/Producer.h>
 #include <tulips/stack/tcpv4/Options.h>
@@ -39,14 +40,31 @@
 namespace tulips { namespace stack { namespace tcpv4 {
 
 /*
- * We rely on the compiler to wrap around the value of the next segment. We
- * need at least 3 bits for NRTX to SEGM_B cannot be more that 5.
+ * Number of in-flight segments per connection, as a power of 2. It can be set
+ * at compile time with TULIPS_TCP_SEGMENT_BITS, from 16 segments for a compact
+ * footprint up to 256 segments for bandwidth-delay product sized windows. We
+ * rely on the compiler to wrap around the value of the next segment.
  */
-#define SEGM_B 4
-#define NRTX_B 9 - SEGM_B
+#ifndef TULIPS_TCP_SEGMENT_BITS
+#define TULIPS_TCP_SEGMENT_BITS 4
+#endif
+
+#define SEGM_B TULIPS_TCP_SEGMENT_BITS
+
+static_assert(SEGM_B >= 4 && SEGM_B <= 8,
+              "TULIPS_TCP_SEGMENT_BITS must be between 4 and 8");
+
+/*
+ * Length of the header template of a connection: Ethernet, IPv4 and TCP.
+ */
+static constexpr uint16_t USED TEMPLATE_LEN =
+  ethernet::HEADER_LEN + HEADER_OVERHEAD;
 
 #define HAS_NODELAY(__e) (__e.m_opts & Connection::NO_DELAY)
 #define HAS_DELAYED_ACK(__e) (__e.m_opts & Connection::DELAYED_ACK)
+#define HAS_COALESCE(__e) (__e.m_opts & Connection::COALESCE)
+#define HAS_SEGMENTATION(__e) (__e.m_opts & Connection::SEGMENTATION)
+#define HAS_KEEPALIVE(__e) (__e.m_opts & Connection::KEEPALIVE)
 
 class Connection
 {
@@ -68,10 +86,32 @@ public:
     TIME_WAIT = 0xB,
   };
 
+  /*
+   * Congestion control is disabled unless NEWRENO, CUBIC or DCTCP is set, in
+   * which case the amount of data in flight is bounded by the congestion
+   * window. If more than one is set, DCTCP takes precedence over CUBIC, which
+   * takes precedence over NEWRENO. DCTCP relies on ECN, which is not
+   * negotiated: both ends of the connection are expected to support it.
+   *
+   * With COALESCE, the consecutive in-order segments received in a burst are
+   * delivered to the application at once, as a list of fragments.
+   *
+   * With SEGMENTATION, a payload larger than the MSS is sliced into as many
+   * segments as the connection can send in a single call to send().
+   *
+   * With KEEPALIVE, an idle connection is probed and reaped if the peer does
+   * not answer the probes.
+   */
   enum Option
   {
     NO_DELAY = 0x1,
-    DELAYED_ACK = 0x2
+    DELAYED_ACK = 0x2,
+    NEWRENO = 0x4,
+    CUBIC = 0x8,
+    DCTCP = 0x10,
+    COALESCE = 0x20,
+    SEGMENTATION = 0x40,
+    KEEPALIVE = 0x80
   };
 
   Connection();
@@ -86,39 +126,94 @@ public:
 
   inline void setCookie(void* const cookie) { m_cookie = cookie; }
 
-  inline void setOptions(const uint8_t opts) { m_opts |= opts; }
+  inline void setOptions(const uint16_t opts) { m_opts |= opts; }
 
-  inline void clearOptions(const uint8_t opts) { m_opts &= ~opts; }
+  /*
+   * Set the options along with the KEEPALIVE parameters: the idle time before
+   * the first probe and the interval between probes, in seconds, and the
+   * number of unanswered probes after which the connection is reaped.
+   */
+  inline void setOptions(const uint16_t opts, const uint16_t idle,
+                         const uint16_t intvl, const uint8_t count)
+  {
+    m_opts |= opts;
+    m_kaidle = idle;
+    m_kaintvl = intvl;
+    m_kacnt = count;
+  }
+
+  inline void clearOptions(const uint16_t opts) { m_opts &= ~opts; }
 
   inline bool isNewDataPushed() const { return m_pshdata; }
 
+  /*
+   * Defer the consumption of the received data: the application reports the
+   * data it has consumed with Processor::consume(), and the window advertised
+   * to the peer is the space left in a receive buffer of len bytes. The data
+   * received until then is considered consumed. The window advertised until
+   * then is not shrunk, so the peer may still fill it.
+   */
+  inline void setReceiveBuffer(const uint32_t len)
+  {
+    m_rcvbuf = len;
+    m_rcvcon = m_rcv_nxt;
+    m_rcvdefer = true;
+  }
+
 private:
   static constexpr size_t SEGMENT_COUNT = 1 << SEGM_B;
   static constexpr size_t SEGMENT_BMASK = SEGMENT_COUNT - 1;
 
+  /*
+   * RTT estimations are kept in units of 2^RTT_SHIFT clock cycles.
+   */
+  static constexpr size_t RTT_SHIFT = 4;
+
   inline bool isActive() const { return m_state != CLOSED; }
 
-  inline bool hasAvailableSegments() const
+  /*
+   * Outstanding segments are stored in sequence order in a ring, starting from
+   * the segment index. The ring is tracked by its head and its length.
+   */
+  inline bool hasAvailableSegments() const { return m_segcnt < SEGMENT_COUNT; }
+
+  inline bool hasOutstandingSegments() const { return m_segcnt != 0; }
+
+  inline bool hasPendingSendData() const { return m_slen != 0; }
+
+  /*
+   * Number of bytes sent and not yet acknowledged.
+   */
+  inline uint32_t inflight() const
   {
-    for (size_t i = 0; i < SEGMENT_COUNT; i += 1) {
-      if (m_segments[i].m_len == 0) {
-        return true;
-      }
-    }
-    return false;
+    return m_segcnt == 0 ? 0 : m_snd_nxt - m_segments[m_segidx].m_seq;
   }
 
-  inline bool hasOutstandingSegments() const
+  /*
+   * A new segment can be sent if one is available and if the congestion
+   * window, when enabled, is not full.
+   */
+  inline bool canSend() const
   {
-    for (size_t i = 0; i < SEGMENT_COUNT; i += 1) {
-      if (m_segments[i].m_len != 0) {
-        return true;
-      }
-    }
-    return false;
+    return hasAvailableSegments() && (algorithm() == Congestion::NONE ||
+                                      inflight() < m_cc.window());
   }
 
-  inline bool hasPendingSendData() const { return m_slen != 0; }
+  /*
+   * ECN codepoint of the outgoing segments. Only DCTCP uses ECN.
+   */
+  inline uint8_t ecn() const
+  {
+    return m_opts & DCTCP ? ipv4::ECN_ECT0 : ipv4::ECN_NOT_ECT;
+  }
+
+  inline Congestion::Algorithm algorithm() const
+  {
+    return m_opts & DCTCP     ? Congestion::DCTCP
+           : m_opts & CUBIC   ? Congestion::CUBIC
+           : m_opts & NEWRENO ? Congestion::NEWRENO
+                              : Congestion::NONE;
+  }
 
   uint32_t window() const { return (uint32_t)m_window << m_wndscl; }
 
@@ -131,41 +226,127 @@ private:
 
   inline Segment& segment() { return m_segments[m_segidx]; }
 
+  /*
+   * Get the n-th outstanding segment, starting from the oldest one.
+   */
+  inline Segment& segment(const size_t n)
+  {
+    return m_segments[(m_segidx + n) & SEGMENT_BMASK];
+  }
+
+  /*
+   * Claim the segment at the tail of the ring.
+   */
   inline Segment& nextAvailableSegment()
   {
-    size_t idx = 0;
-    for (size_t i = m_segidx; i < m_segidx + SEGMENT_COUNT; i += 1) {
-      idx = i & SEGMENT_BMASK;
-      if (m_segments[idx].m_len == 0) {
-        return m_segments[idx];
-      }
+    if (m_segcnt == SEGMENT_COUNT) {
+      throw std::runtime_error("have you called hasAvailableSegments()?");
     }
-    throw std::runtime_error("have you called hasAvailableSegments()?");
+    return segment(m_segcnt++);
   }
 
-  inline size_t level() const
+  /*
+   * Release the n oldest segments at once. The compiler will generate the
+   * wrap-around appropriate for the bit length of the index.
+   */
+  inline void releaseSegments(const size_t n)
   {
-    size_t level = 0;
-    for (size_t i = 0; i < SEGMENT_COUNT; i += 1) {
-      if (m_segments[i].m_len == 0) {
-        level += 1;
-      }
-    }
-    return level;
+    m_segidx += n;
+    m_segcnt -= n;
   }
 
-  inline void updateRttEstimation()
+  inline size_t level() const { return SEGMENT_COUNT - m_segcnt; }
+
+  inline void updateRttEstimation(const system::Clock::Value rtt)
   {
-    int8_t m = m_rto - m_timer;
+    system::Clock::Value val = rtt >> RTT_SHIFT;
+    uint32_t r = val == 0 ? 1 : val > UINT32_MAX ? UINT32_MAX : val;
     /*
-     * This is taken directly from VJs original code in his paper
+     * First measurement, as per RFC 6298 (2.2).
      */
-    m = m - (m_sa >> 3);
-    m_sa += m;
-    m = m < 0 ? -m : m;
-    m = m - (m_sv >> 2);
-    m_sv += m;
-    m_rto = (m_sa >> 3) + m_sv;
+    if (m_srtt == 0) {
+      m_srtt = r;
+      m_rttvar = r >> 1;
+      return;
+    }
+    /*
+     * Subsequent measurements, as per RFC 6298 (2.3), with alpha = 1/8 and
+     * beta = 1/4.
+     */
+    uint32_t delta = m_srtt > r ? m_srtt - r : r - m_srtt;
+    m_rttvar = m_rttvar - (m_rttvar >> 2) + (delta >> 2);
+    m_srtt = m_srtt - (m_srtt >> 3) + (r >> 3);
+  }
+
+  /*
+   * Mark the segments fully covered by the SACK block [left, right).
+   */
+  inline void markSacked(const uint32_t left, const uint32_t right)
+  {
+    for (size_t i = 0; i < m_segcnt; i += 1) {
+      Segment& seg = segment(i);
+      if ((int32_t)(seg.m_seq - left) >= 0 &&
+          (int32_t)(right - (seg.m_seq + seg.m_len)) >= 0) {
+        seg.m_sacked = true;
+      }
+    }
+  }
+
+  /*
+   * Start a new loss recovery. SACK information must be discarded after a
+   * retransmission time-out as the peer may have reneged on it (RFC 2018).
+   */
+  inline void startRecovery(const bool timeout)
+  {
+    for (size_t i = 0; i < m_segcnt; i += 1) {
+      Segment& seg = segment(i);
+      seg.m_rexmit = false;
+      seg.m_sacked = timeout ? false : seg.m_sacked;
+    }
+    m_dupacks = 0;
+    m_recovery = true;
+    m_recover = m_snd_nxt;
+  }
+
+  /*
+   * Space left in the receive buffer. Unless consumption is deferred, the data
+   * is consumed as soon as it is delivered.
+   */
+  inline uint32_t receiveSpace() const
+  {
+    if (!m_rcvdefer) {
+      return m_rcvbuf;
+    }
+    uint32_t used = m_rcv_nxt - m_rcvcon;
+    return used < m_rcvbuf ? m_rcvbuf - used : 0;
+  }
+
+  /*
+   * Space left in the window last advertised to the peer.
+   */
+  inline uint32_t advertisedSpace() const
+  {
+    int32_t space = m_rcvadv - m_rcv_nxt;
+    return space > 0 ? space : 0;
+  }
+
+  /*
+   * Silly window syndrome avoidance (RFC 1122 4.2.3.3): the right edge of the
+   * window only moves forward by at least min(half the buffer, MSS).
+   */
+  inline bool canOpenWindow(const uint32_t space) const
+  {
+    uint32_t thresh = m_rcvbuf >> 1 < m_mss ? m_rcvbuf >> 1 : m_mss;
+    return space >= advertisedSpace() + thresh;
+  }
+
+  /*
+   * Length of the TCP header of the segments, including the options sent with
+   * every segment.
+   */
+  inline uint8_t headerLength() const
+  {
+    return HEADER_LEN + (m_tsok ? Options::TSO_PAD : 0);
   }
 
   inline void resetSendBuffer()
@@ -175,7 +356,7 @@ private:
   }
 
   /*
-   * Member variables, all in one cache line.
+   * Member variables, the most used ones in the first cache line.
    */
 
   ID m_id; // 2 - Connection ID
@@ -195,32 +376,65 @@ private:
     uint64_t m_ackdata : 1;     // . - Connection has been acked
     uint64_t m_newdata : 1;     // . - Connection has new data
     uint64_t m_pshdata : 1;     // . - Connection data is being pushed
-    uint64_t m_wndscl : 8;      // . - Remote peer window scale (max is 14)
+    uint64_t m_wndscl : 4;      // . - Remote peer window scale (max is 14)
+    uint64_t m_dupacks : 2;     // . - Number of duplicate ACKs received
+    uint64_t m_recovery : 1;    // . - Connection is recovering from a loss
+    uint64_t m_sackperm : 1;    // . - Remote peer sends SACK blocks
+    uint64_t m_tsok : 1;        // . - Timestamps are in use (RFC 7323)
     uint64_t m_window : 16;     // . - Remote peer window
-    uint64_t m_segidx : SEGM_B; // 8 - Free segment index
-    uint64_t m_nrtx : NRTX_B;   // . - Number of retransmissions (3 bit minimum)
+    uint64_t m_segidx : SEGM_B; // 8 - Oldest outstanding segment index
     uint64_t m_slen : 24;       // . - Length of the send buffer
   };
 
-  uint8_t* m_sdat; // 8 - Send buffer
-
+  uint8_t* m_sdat;       // 8 - Send buffer
+  Segment* m_segments;   // 8 - Segments, in the side array of the processor
   uint16_t m_initialmss; // 2 - Initial maximum segment size for the connection
   uint16_t m_mss;        // 2 - Current maximum segment size for the connection
+  uint16_t m_opts;       // 2 - Connection options (NO_DELAY, etc..)
+  uint16_t m_segcnt;     // 2 - Number of outstanding segments
+  void* m_cookie;        // 8 - Application state
 
-  uint8_t m_sa;    // 1 - Retransmission time-out calculation state
-  uint8_t m_sv;    // 1 - Retransmission time-out calculation state
-  uint8_t m_rto;   // 1 - Retransmission time-out
-  uint8_t m_timer; // 1 - Retransmission timer
+  /*
+   * RTT estimation and congestion control state, in its own cache line.
+   */
+
+  uint32_t m_srtt __attribute__((aligned(64))); // 4 - Smoothed RTT
+  uint32_t m_rttvar;                            // 4 - RTT variation
+  Congestion m_cc; // 56 - Congestion control state
+
+  /*
+   * Loss recovery state, in its own cache line.
+   */
 
-  uint64_t m_opts; // 8 - Connection options (NO_DELAY, etc..)
-  void* m_cookie;  // 8 - Application state
+  uint32_t m_recover __attribute__((aligned(64))); // 4 - Recovery point
+  bool m_ecnce;     // 1 - Last received data segment was CE-marked
+  bool m_ackpend;   // 1 - An ACK for the received data is delayed
+  bool m_ackq;      // 1 - Connection is in the delayed ACK queue
+  uint8_t m_nprobe; // 1 - Number of zero window probes sent
+  uint8_t m_nrtx;   // 1 - Number of retransmissions
+
+  uint32_t m_tsrecent;          // 4 - Timestamp to echo (TS.Recent)
+  system::Clock::Value m_tsage; // 8 - Time when TS.Recent was last updated
+
+  system::Clock::Value m_kalast; // 8 - Time when a segment was last received
+  uint16_t m_kaidle;             // 2 - Keep-alive idle time, in seconds
+  uint16_t m_kaintvl;            // 2 - Keep-alive probe interval, in seconds
+  uint8_t m_kacnt;               // 1 - Number of keep-alive probes to send
+  uint8_t m_kaprobe;             // 1 - Number of keep-alive probes sent
+
+  uint32_t m_rcvbuf; // 4 - Size of the receive buffer
+  uint32_t m_rcvcon; // 4 - Sequence number consumed by the application
+  uint32_t m_rcvadv; // 4 - Right edge of the advertised receive window
+  uint8_t m_rcvwsc;  // 1 - Scale of the advertised receive window
+  bool m_wscok;      // 1 - Remote peer sent a window scale option
+  bool m_rcvdefer;   // 1 - Consumption of the received data is deferred
 
   /*
-   * Segments. Size is 16B per segment, 4 segments per cache line, for a maximum
-   * of 16 segments (segment index is 4 bits).
+   * Transmit header template, in its own cache line.
    */
 
-  Segment m_segments[SEGMENT_COUNT];
+  uint8_t m_hdr[TEMPLATE_LEN] __attribute__((aligned(64))); // 54 - Headers
+  uint16_t m_hdrsum; // 2 - Partial checksum of the TCP pseudo-header
 
   /*
    * Friendship declaration.
@@ -228,10 +442,11 @@ private:
 
   friend class Processor;
   friend void Options::parse(Connection&, const uint16_t, const uint8_t* const);
+  friend void Options::parseSack(Connection&, const uint16_t,
+                                 const uint8_t* const);
 
 } __attribute__((aligned(64)));
 
-static_assert(sizeof(Connection) == (1 << SEGM_B) * sizeof(Segment) + 64,
-              "Size of tcpv4::Connection is invalid");
+static_assert(sizeof(Connection) == 256, "Size of tcpv4::Connection is invalid");
 
 }}}
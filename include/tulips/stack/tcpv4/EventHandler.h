@@ -29,6 +29,8 @@
 
 #include <tulips/api/Action.h>
 #include <tulips/stack/tcpv4/Connection.h>
+#include <tulips/system/Compiler.h>
+#include <tulips/transport/Processor.h>
 #include <cstdint>
 
 namespace tulips { namespace stack { namespace tcpv4 {
@@ -59,6 +61,16 @@ public:
    */
   virtual void onSent(Connection& c) = 0;
 
+  /*
+   * Called when len bytes of data passed to sendZeroCopy() are no longer used
+   * by the connection c, either because they have been acknowledged or because
+   * the connection is gone. Data is released in the order it was sent.
+   */
+  virtual void onReleased(UNUSED Connection& c,
+                          UNUSED const uint8_t* const data,
+                          UNUSED const uint32_t len)
+  {}
+
   /*
    * Called when data for c has been acked.
    */
@@ -83,6 +95,43 @@ public:
                            const uint32_t len, const uint32_t alen,
                            uint8_t* const sdata, uint32_t& slen) = 0;
 
+  /*
+   * Called when coalesced new data on c has been received, as a list of
+   * fragments. By default, the fragments are delivered one at a time.
+   */
+  virtual Action onNewData(Connection& c, const transport::Frame* const frags,
+                           const size_t count)
+  {
+    for (size_t i = 0; i < count; i += 1) {
+      Action act = onNewData(c, frags[i].data, frags[i].len);
+      if (act != Action::Continue) {
+        return act;
+      }
+    }
+    return Action::Continue;
+  }
+
+  /*
+   * Called when coalesced new data on c has been received, as a list of
+   * fragments, and a response can be sent. By default, the fragments are
+   * delivered one at a time.
+   */
+  virtual Action onNewData(Connection& c, const transport::Frame* const frags,
+                           const size_t count, const uint32_t alen,
+                           uint8_t* const sdata, uint32_t& slen)
+  {
+    for (size_t i = 0; i < count; i += 1) {
+      uint32_t rlen = 0;
+      Action act = onNewData(c, frags[i].data, frags[i].len, alen - slen,
+                             sdata + slen, rlen);
+      slen += rlen;
+      if (act != Action::Continue) {
+        return act;
+      }
+    }
+    return Action::Continue;
+  }
+
   /*
    * Called when the connection c has been closed.
    */
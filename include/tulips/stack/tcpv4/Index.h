@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <tulips/stack/IPv4.h>
+#include <tulips/stack/TCPv4.h>
+#include <tulips/stack/tcpv4/Connection.h>
+#include <cstdint>
+#include <vector>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Connection lookup table, keyed on the (remote IP, remote port, local port)
+ * tuple. It uses open addressing with linear probing and backward-shift
+ * deletion, so that no tombstone is ever left behind in the table.
+ */
+class Index
+{
+public:
+  static constexpr Connection::ID NONE = Connection::ID(-1);
+
+  Index(const size_t nconn);
+
+  inline Connection::ID find(ipv4::Address const& ripaddr, const Port rport,
+                             const Port lport) const
+  {
+    const Key key = keyOf(ripaddr, rport, lport);
+    for (size_t i = slotOf(key);; i = (i + 1) & m_mask) {
+      Entry const& e = m_table[i];
+      if (e.m_id == NONE || e.m_key == key) {
+        return e.m_id;
+      }
+    }
+  }
+
+  void insert(ipv4::Address const& ripaddr, const Port rport, const Port lport,
+              const Connection::ID id);
+
+  void erase(ipv4::Address const& ripaddr, const Port rport, const Port lport);
+
+private:
+  using Key = uint64_t;
+
+  struct Entry
+  {
+    Key m_key;            // 8 - Packed connection tuple
+    Connection::ID m_id;  // 2 - Connection ID, NONE if the entry is free
+  };
+
+  static inline Key keyOf(ipv4::Address const& ripaddr, const Port rport,
+                          const Port lport)
+  {
+    return (Key)*ripaddr.data() << 32 | (Key)rport << 16 | lport;
+  }
+
+  /*
+   * Fibonacci hashing: the top bits of the product are the best mixed.
+   */
+  inline size_t slotOf(const Key key) const
+  {
+    return (key * 0x9E3779B97F4A7C15ULL) >> m_shift;
+  }
+
+  const size_t m_shift;
+  const size_t m_mask;
+  std::vector<Entry> m_table;
+};
+
+}}}
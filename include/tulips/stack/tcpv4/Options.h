@@ -36,14 +36,35 @@ class Connection;
 
 namespace Options {
 
-static constexpr int USED END = 0;     // End of TCP options list
-static constexpr int USED NOOP = 1;    // "No-operation" TCP option
-static constexpr int USED MSS = 2;     // Maximum segment size TCP option
-static constexpr int USED MSS_LEN = 4; // Length of TCP MSS option
-static constexpr int USED WSC = 3;     // Window scaling option
-static constexpr int USED WSC_LEN = 3; // Length of the TCP WSC option
+static constexpr int USED END = 0;      // End of TCP options list
+static constexpr int USED NOOP = 1;     // "No-operation" TCP option
+static constexpr int USED MSS = 2;      // Maximum segment size TCP option
+static constexpr int USED MSS_LEN = 4;  // Length of TCP MSS option
+static constexpr int USED WSC = 3;      // Window scaling option
+static constexpr int USED WSC_LEN = 3;  // Length of the TCP WSC option
+static constexpr int USED SAP = 4;      // SACK permitted option
+static constexpr int USED SAP_LEN = 2;  // Length of the TCP SAP option
+static constexpr int USED SACK = 5;     // Selective acknowledgement option
+static constexpr int USED SACK_BLK = 8; // Length of a SACK block
+static constexpr int USED TSO = 8;      // Timestamps option
+static constexpr int USED TSO_LEN = 10; // Length of the TCP TSO option
+static constexpr int USED TSO_PAD = 12; // Length of the TSO option with NOOPs
 
+/*
+ * Parse the options of a SYN or a SYN/ACK.
+ */
 void parse(Connection& e, const uint16_t len, const uint8_t* const data);
 
+/*
+ * Look for the timestamps option of a segment. Return true if it was found.
+ */
+bool parseTimestamps(const uint16_t len, const uint8_t* const data,
+                     uint32_t& tsval, uint32_t& tsecr);
+
+/*
+ * Parse the SACK blocks of an ACK and mark the segments they cover.
+ */
+void parseSack(Connection& e, const uint16_t len, const uint8_t* const data);
+
 }
 }}}
@@ -30,6 +30,11 @@
 #include <tulips/system/Buffer.h>
 #include <tulips/stack/tcpv4/Connection.h>
 #include <tulips/stack/tcpv4/EventHandler.h>
+#include <tulips/stack/tcpv4/Index.h>
+#include <tulips/stack/tcpv4/Queue.h>
+#include <tulips/stack/tcpv4/Reassembly.h>
+#include <tulips/stack/tcpv4/SynCookie.h>
+#include <tulips/stack/tcpv4/Timers.h>
 #include <tulips/stack/TCPv4.h>
 #include <tulips/stack/ethernet/Producer.h>
 #include <tulips/stack/ethernet/Processor.h>
@@ -42,6 +47,7 @@
 #include <set>
 #include <stdexcept>
 #include <vector>
+#include <sys/uio.h>
 
 #define OUTTCP ((Header*)outdata)
 
@@ -63,6 +69,47 @@ namespace tulips { namespace stack { namespace tcpv4 {
 static constexpr int USED MAXRTX = 5;
 static constexpr int USED MAXSYNRTX = 5;
 static constexpr int USED TIME_WAIT_TIMEOUT = 120;
+static constexpr int USED DUPACK_THRESHOLD = 3;
+static constexpr int USED MAXPROBESHIFT = 10;
+
+/*
+ * Upper bound in milliseconds on the delay of an ACK outside of a burst, well
+ * below the 500 ms allowed by RFC 1122 (4.2.3.2).
+ */
+static constexpr int USED DELACK_TIMEOUT = 200;
+
+/*
+ * Default keep-alive parameters, as per RFC 1122 (4.2.3.6): idle time and
+ * interval between probes in seconds, and number of probes.
+ */
+static constexpr int USED KEEPALIVE_IDLE = 7200;
+static constexpr int USED KEEPALIVE_INTVL = 75;
+static constexpr int USED KEEPALIVE_COUNT = 9;
+
+/*
+ * Default size of the receive buffer of the connections.
+ */
+static constexpr uint32_t USED RCVBUF = 1 << 20;
+
+/*
+ * The timestamps clock ticks every 2^TS_SHIFT clock cycles. As it wraps around
+ * much faster than the clock recommended by RFC 7323, TS.Recent is considered
+ * invalid after PAWS_IDLE seconds of inactivity.
+ */
+static constexpr int USED TS_SHIFT = 10;
+static constexpr int USED PAWS_IDLE = 60;
+
+/*
+ * Out-of-order reassembly limits: number of buffers per connection, and number
+ * of buffers shared by all connections.
+ */
+static constexpr size_t USED OOO_DEPTH = 8;
+static constexpr size_t USED OOO_POOL = 256;
+
+/*
+ * Maximum number of in-order segments coalesced within a receive burst.
+ */
+static constexpr size_t USED GRO_DEPTH = 64;
 
 /*
  * The TCPv4 statistics.
@@ -76,8 +123,19 @@ struct Statistics
   uint64_t ackerr;  // Number of TCP segments with a bad ACK number.
   uint64_t rst;     // Number of recevied TCP RST (reset) segments.
   uint64_t rexmit;  // Number of retransmitted TCP segments.
+  uint64_t fastrx;  // Number of fast retransmissions.
+  uint64_t ooohit;  // Number of out-of-order TCP segments queued.
+  uint64_t ooodep;  // Number of out-of-order TCP segments currently queued.
+  uint64_t ooodrop; // Number of out-of-order TCP segments dropped (overflow).
   uint64_t syndrop; // Number of dropped SYNs (no connection was avaliable).
   uint64_t synrst;  // Number of SYNs for closed ports, triggering a RST.
+  uint64_t delack;  // Number of delayed ACKs sent when flushed.
+  uint64_t gro;     // Number of TCP segments coalesced in a burst.
+  uint64_t paws;    // Number of TCP segments rejected by PAWS.
+  uint64_t probe;   // Number of zero window probes sent.
+  uint64_t kadrop;  // Number of idle connections reaped by keep-alive.
+  uint64_t cookie;  // Number of SYN cookies sent.
+  uint64_t ckerr;   // Number of ACKs with an invalid SYN cookie.
 };
 
 /*
@@ -90,8 +148,22 @@ public:
             ipv4::Producer& ip4, EventHandler& h, const size_t nconn);
 
   Status run() override;
+  using transport::Processor::process;
   Status process(const uint16_t len, const uint8_t* const data) override;
 
+  /*
+   * Mark the beginning of a burst of incoming segments. Until the next flush,
+   * the in-order segments of connections with the COALESCE option are held
+   * back and delivered together.
+   */
+  void begin() { m_burst = true; }
+
+  /*
+   * Flush the protocol state at the end of a burst of incoming segments:
+   * deliver the coalesced segments and send the ACKs that were delayed.
+   */
+  Status flush();
+
   Processor& setEthernetProcessor(ethernet::Processor& eth)
   {
     m_ethfrom = &eth;
@@ -132,11 +204,93 @@ public:
   Status send(Connection::ID const& id, const uint32_t len,
               const uint8_t* const data, uint32_t& off);
 
+  /*
+   * Send data without copying it. The segments reference the data, which must
+   * remain valid until it is handed back by the onReleased() callback. The
+   * off parameter has the same meaning as for send().
+   */
+  Status sendZeroCopy(Connection::ID const& id, const uint32_t len,
+                      const uint8_t* const data, uint32_t& off);
+
+  /*
+   * Send data gathered from multiple fragments. The off parameter is an offset
+   * in the concatenation of the fragments and has the same meaning as for
+   * send().
+   */
+  Status sendv(Connection::ID const& id, const struct iovec* const iov,
+               const size_t count, uint32_t& off);
+
+  /*
+   * Defer the consumption of the data received on a connection, with a
+   * receive buffer of len bytes (see Connection::setReceiveBuffer()).
+   */
+  Status setReceiveBuffer(Connection::ID const& id, const uint32_t len);
+
+  /*
+   * Report len bytes of received data as consumed by the application. A
+   * window update is sent if the window opens enough.
+   */
+  Status consume(Connection::ID const& id, const uint32_t len);
+
   Status get(Connection::ID const& id, ipv4::Address& ripaddr, Port& lport,
              Port& rport);
 
   void* cookie(Connection::ID const& id) const;
 
+  /*
+   * Bound the retransmission time-out computed from the RTT estimation. Both
+   * values are expressed in clock cycles.
+   */
+
+  Processor& setRtoBounds(const system::Clock::Value min,
+                          const system::Clock::Value max)
+  {
+    m_minrto = min;
+    m_maxrto = max;
+    return *this;
+  }
+
+  /*
+   * Offer the timestamps option (RFC 7323) to the peers. It is used on the
+   * connections established afterward if the peer supports it too.
+   */
+
+  Processor& setTimestamps(const bool enable)
+  {
+    m_timestamps = enable;
+    return *this;
+  }
+
+  /*
+   * Answer the SYNs with SYN cookies. No connection is allocated until the
+   * handshake completes, so that half-open connections cannot exhaust the
+   * connection table. Timestamps are not offered in this mode.
+   */
+
+  Processor& setSynCookies(const bool enable)
+  {
+    m_syncookies = enable;
+    return *this;
+  }
+
+  /*
+   * Size of the receive buffer of the connections, which bounds the window
+   * they advertise. The window scale offered to the peers is derived from it,
+   * and applies to the connections established afterward.
+   */
+
+  Processor& setReceiveWindow(const uint32_t len)
+  {
+    m_rcvbuf = len;
+    m_rcvwsc = 0;
+    while ((len >> m_rcvwsc) > 0xFFFF && m_rcvwsc < 14) {
+      m_rcvwsc += 1;
+    }
+    return *this;
+  }
+
+  Statistics const& statistics() const { return m_stats; }
+
   /*
    * Some connection related methods, mostly for testing.
    */
@@ -153,16 +307,207 @@ public:
 
 private:
   using Ports = std::set<Port>;
+  using PortMap = std::vector<uint64_t>;
   using Connections = std::vector<Connection>;
+  using Segments = std::vector<Segment>;
+  using References = std::vector<const uint8_t*>;
+  using FreeList = std::vector<Connection::ID>;
+  using AckQueue = std::vector<Connection::ID>;
+  using Fragments = std::vector<transport::Frame>;
+
+  /*
+   * Partial checksum of the TCP pseudo-header, without the TCP length. It is
+   * the seed of the checksum of the segments.
+   */
+  static uint16_t pseudoHeader(ipv4::Address const& src,
+                               ipv4::Address const& dst);
 
 #if !(defined(TULIPS_HAS_HW_CHECKSUM) && defined(TULIPS_DISABLE_CHECKSUM_CHECK))
-  static uint16_t checksum(ipv4::Address const& src, ipv4::Address const& dst,
-                           const uint16_t len, const uint8_t* const data);
+  static uint16_t checksum(const uint16_t seed, const uint16_t len,
+                           const uint8_t* const data);
+#endif
+#ifndef TULIPS_HAS_HW_CHECKSUM
+  /*
+   * Checksum of a segment whose payload has already been summed into psum.
+   * Only the header is summed (RFC 1071).
+   */
+  static uint16_t checksum(const uint16_t seed, const uint16_t len,
+                           const uint8_t* const data, const uint16_t plen,
+                           const uint16_t psum);
 #endif
 
+  Status demux(const uint16_t len, const uint8_t* const data);
   Status process(Connection& e, const uint16_t len, const uint8_t* const data);
+  Status deliver();
   Status reset(const uint16_t len, const uint8_t* const data);
 
+  /*
+   * Take a connection for the peer of a handshake segment, in SYN_RCVD with
+   * a send buffer. The connection is nullptr if none is available.
+   */
+  Status accept(const uint8_t* const data, const uint32_t rcvnxt,
+                const uint32_t sndnxt, Connection*& e);
+  Status acceptCookie(const uint16_t len, const uint8_t* const data);
+
+  Connection* acquire();
+  void release(Connection& e);
+
+  Port acquirePort();
+
+  Status onRexmitTimeout(Connection& e, const system::Clock::Value now);
+  Status onPersistTimeout(Connection& e, const system::Clock::Value now);
+  Status onKeepAliveTimeout(Connection& e, const system::Clock::Value now);
+
+  /*
+   * Delay the ACK of the received data until the next flush. A connection is
+   * queued at most once, and the time of the oldest delayed ACK is recorded.
+   */
+  inline void delayAck(Connection& e)
+  {
+    e.m_ackpend = true;
+    if (!e.m_ackq) {
+      if (m_delacks.empty()) {
+        m_delackts = system::Clock::read();
+      }
+      e.m_ackq = true;
+      m_delacks.push_back(e.m_id);
+    }
+  }
+
+  /*
+   * Check if a segment may be coalesced with the segments held back for its
+   * connection: in-order data with no control flag other than ACK/PSH.
+   */
+  bool isCoalescable(Connection const& e, const uint16_t len,
+                     const uint8_t* const data) const;
+
+  /*
+   * Retransmission time-out of a connection, as per RFC 6298 (2.3). The
+   * initial RTO is used until the first RTT measurement is made.
+   */
+  inline system::Clock::Value rto(Connection const& e) const
+  {
+    if (e.m_srtt == 0) {
+      return RTO * CLOCK_SECOND;
+    }
+    system::Clock::Value var = (system::Clock::Value)e.m_rttvar << 2;
+    system::Clock::Value val = (e.m_srtt + (var == 0 ? 1 : var))
+                               << Connection::RTT_SHIFT;
+    return val < m_minrto ? m_minrto : val > m_maxrto ? m_maxrto : val;
+  }
+
+  /*
+   * Maximum length of the payload of the next segment of a connection.
+   */
+  inline uint32_t sendBound(Connection const& e) const
+  {
+    uint32_t mss = m_mss - (e.headerLength() - HEADER_LEN);
+    return e.window() < mss ? e.window() : mss;
+  }
+
+  /*
+   * Current value of the timestamps clock.
+   */
+  inline static uint32_t timestamp()
+  {
+    return system::Clock::read() >> TS_SHIFT;
+  }
+
+  /*
+   * Use timestamps on a connection if both ends offered them. The options
+   * sent with every segment are then deducted from the MSS.
+   */
+  inline void setupTimestamps(Connection& e)
+  {
+    e.m_tsok = e.m_tsok && m_timestamps;
+    if (e.m_tsok) {
+      e.m_initialmss -= Options::TSO_PAD;
+      e.m_mss = e.m_initialmss;
+      e.m_tsage = system::Clock::read();
+    }
+  }
+
+  /*
+   * Scale the receive window of a connection if the peer sent the window
+   * scale option too (RFC 7323).
+   */
+  inline void setupWindowScale(Connection& e)
+  {
+    e.m_rcvwsc = e.m_wscok ? m_rcvwsc : 0;
+  }
+
+  /*
+   * Build the Ethernet, IPv4 and TCP headers of the segments of a connection,
+   * and the partial checksum of its pseudo-header.
+   */
+  void setupTemplate(Connection& e);
+
+  /*
+   * Prepare a send buffer for a connection from its header template.
+   */
+  inline Status prepare(Connection& e, uint8_t*& buf)
+  {
+    return m_ipv4to.prepare(buf, e.m_hdr, TEMPLATE_LEN, e.ecn());
+  }
+
+  /*
+   * Write the timestamps option in the layout recommended by RFC 7323.
+   */
+  void writeTimestamps(Connection const& e, uint8_t* const opts) const;
+
+  /*
+   * Arm the retransmission timer of a connection with the current RTO.
+   */
+  inline void setRexmitTimer(Connection& e)
+  {
+    m_timers.arm(e.m_id, Timers::REXMIT, system::Clock::read() + rto(e));
+  }
+
+  /*
+   * Arm the persist timer of a connection with the current RTO, backed off
+   * exponentially with the number of probes sent, up to the maximum RTO.
+   */
+  inline void setPersistTimer(Connection& e, const system::Clock::Value now)
+  {
+    system::Clock::Value period = rto(e) << e.m_nprobe;
+    period = period > m_maxrto ? m_maxrto : period;
+    m_timers.arm(e.m_id, Timers::PERSIST, now + period);
+  }
+
+  /*
+   * Record the activity of a connection with the KEEPALIVE option. The
+   * keep-alive timer is only armed if it is not already: it is not pushed back
+   * on each segment, but re-armed from the last activity when it expires.
+   */
+  inline void touch(Connection& e)
+  {
+    if (!HAS_KEEPALIVE(e)) {
+      return;
+    }
+    e.m_kalast = system::Clock::read();
+    e.m_kaprobe = 0;
+    if (!m_timers.armed(e.m_id, Timers::KEEPALIVE)) {
+      m_timers.arm(e.m_id, Timers::KEEPALIVE,
+                   e.m_kalast + e.m_kaidle * CLOCK_SECOND);
+    }
+  }
+
+  /*
+   * Arm the FIN_WAIT_2/TIME_WAIT timer of a connection.
+   */
+  inline void setWaitTimer(Connection& e)
+  {
+    m_timers.arm(e.m_id, Timers::WAIT,
+                 system::Clock::read() + TIME_WAIT_TIMEOUT * CLOCK_SECOND);
+  }
+
+  inline bool isPortUsed(const Port port) const
+  {
+    return (m_lports[port >> 6] >> (port & 0x3F)) & 1;
+  }
+
+  Status sendv(Connection& e, const struct iovec* const iov,
+               const size_t count, const uint32_t len, uint32_t& off);
   Status sendNagle(Connection& e, const uint32_t bound);
   Status sendNoDelay(Connection& e, const uint8_t flag = 0);
 
@@ -170,6 +515,14 @@ private:
   Status sendClose(Connection& e);
   Status sendSyn(Connection& e, Segment& s);
   Status sendAck(Connection& e);
+  Status sendProbe(Connection& e);
+  Status sendCookie(const uint8_t* const data);
+
+  /*
+   * Write the options of a SYN or a SYN/ACK after the timestamps.
+   */
+  void writeSynOptions(uint8_t* const opts, const uint16_t mss,
+                       const bool sackperm) const;
 
   inline Status sendSynAck(Connection& e, Segment& s)
   {
@@ -182,8 +535,8 @@ private:
   {
     uint8_t* outdata = s.m_dat;
     OUTTCP->flags |= TCP_FIN;
-    OUTTCP->offset = 5;
-    return send(e, HEADER_LEN, s);
+    OUTTCP->offset = s.m_hlen >> 2;
+    return send(e, s.m_hlen, s);
   }
 
   inline Status sendFinAck(Connection& e, Segment& s)
@@ -193,6 +546,11 @@ private:
     return sendFin(e, s);
   }
 
+  /*
+   * Compute the window advertised by a segment, and record its right edge.
+   */
+  uint16_t receiveWindow(Connection& e, const uint8_t flags);
+
   Status send(Connection& e);
 
   inline Status send(Connection& e, Segment& s, const uint8_t flags = 0)
@@ -203,16 +561,44 @@ private:
      * but Linux seems pretty bent on wanting one. So we play nice. Again.
      */
     OUTTCP->flags = flags | TCP_ACK;
-    OUTTCP->offset = 5;
-    return send(e, s.m_len + HEADER_LEN, s);
+    OUTTCP->offset = s.m_hlen >> 2;
+    return send(e, s.m_len + s.m_hlen, s);
   }
 
   Status send(Connection& e, const uint32_t len, Segment& s);
 
-  Status send(ipv4::Address const& dst, const uint32_t len, const uint16_t mss,
+  Status send(const uint16_t seed, const uint32_t len, const uint16_t mss,
               uint8_t* const outdata);
 
+  /*
+   * Checksum and send a segment. The payload of the segment is summed once,
+   * when it is first sent.
+   */
+  Status sendSegment(Connection const& e, const uint32_t len, Segment& s);
+
+  /*
+   * Reference the application data instead of a copy. The address of the data
+   * is kept in a side array, indexed like the segments.
+   */
+  inline void reference(Segment& s, const uint8_t* const data)
+  {
+    m_zcrefs[&s - m_segments.data()] = data;
+    s.m_zcopy = true;
+  }
+
+  inline const uint8_t* payload(Segment const& s) const
+  {
+    if (s.m_zcopy) {
+      return m_zcrefs[&s - m_segments.data()];
+    }
+    return s.m_dat + s.m_hlen;
+  }
+
+  void releaseZeroCopy(Connection& e, const size_t count);
+
   Status rexmit(Connection& e);
+  Status rexmit(Connection& e, Segment& seg);
+  Status rexmitLost(Connection& e);
 
   transport::Device& m_device;
   ethernet::Producer& m_ethto;
@@ -223,10 +609,31 @@ private:
   ipv4::Processor* m_ipv4from;
   uint32_t m_iss;
   uint32_t m_mss;
+  bool m_timestamps;
+  bool m_syncookies;
+  SynCookie m_syncookie;
+  uint32_t m_rcvbuf;
+  uint8_t m_rcvwsc;
   Ports m_listenports;
+  PortMap m_lports;
   Connections m_conns;
+  Segments m_segments;
+  References m_zcrefs;
+  FreeList m_free;
+  AckQueue m_delacks;
+  system::Clock::Value m_delackts;
+  bool m_burst;
+  Connection::ID m_grocid;
+  Fragments m_grofrags;
+  Queue m_halfopen;
+  Queue m_timewait;
+  Index m_index;
+  Timers m_timers;
+  Reassembly m_ooo;
   Statistics m_stats;
   system::Timer m_timer;
+  system::Clock::Value m_minrto;
+  system::Clock::Value m_maxrto;
 };
 
 }}}
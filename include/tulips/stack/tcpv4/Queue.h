@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <tulips/stack/tcpv4/Connection.h>
+#include <cstdint>
+#include <vector>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Ordered queue of connection IDs. The links are kept in a side table indexed
+ * by connection ID, so that insertion at the tail and removal from anywhere in
+ * the queue are constant-time operations.
+ */
+class Queue
+{
+public:
+  Queue(const size_t nconn);
+
+  inline bool empty() const { return m_next[m_nil] == m_nil; }
+
+  inline Connection::ID front() const { return m_next[m_nil]; }
+
+  inline bool contains(const Connection::ID id) const
+  {
+    return m_next[id] != UNLINKED;
+  }
+
+  inline void push(const Connection::ID id)
+  {
+    const uint32_t last = m_prev[m_nil];
+    m_next[last] = id;
+    m_prev[id] = last;
+    m_next[id] = m_nil;
+    m_prev[m_nil] = id;
+  }
+
+  inline void erase(const Connection::ID id)
+  {
+    if (!contains(id)) {
+      return;
+    }
+    m_next[m_prev[id]] = m_next[id];
+    m_prev[m_next[id]] = m_prev[id];
+    m_next[id] = UNLINKED;
+    m_prev[id] = UNLINKED;
+  }
+
+private:
+  using Links = std::vector<uint32_t>;
+
+  static constexpr uint32_t UNLINKED = uint32_t(-1);
+
+  const uint32_t m_nil;
+  Links m_next;
+  Links m_prev;
+};
+
+}}}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <tulips/stack/tcpv4/Connection.h>
+#include <cstdint>
+#include <vector>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Out-of-order reassembly queues. Segments received ahead of the expected
+ * sequence number are copied into buffers taken from a pool shared by all the
+ * connections. Each connection keeps its buffers in a list ordered by sequence
+ * number, and may not hold more than a fixed number of them.
+ */
+class Reassembly
+{
+public:
+  Reassembly(const size_t nconn, const size_t nbufs, const size_t depth,
+             const size_t bufsz);
+
+  inline bool empty(const Connection::ID id) const
+  {
+    return m_head[id] == NIL;
+  }
+
+  /*
+   * Number of buffers in use, for all connections.
+   */
+  inline size_t depth() const { return m_entries.size() - m_free.size(); }
+
+  /*
+   * Queue a segment. Return false if the segment could not be queued.
+   */
+  bool insert(const Connection::ID id, const uint32_t seq, const uint32_t len,
+              const uint8_t* const data);
+
+  /*
+   * Append the data queued right after the segment [seq, seq + len) and
+   * return the length of the resulting batch. The batch is either the segment
+   * itself or a copy held by the reassembly queues until the next call.
+   */
+  uint32_t merge(const Connection::ID id, const uint32_t seq,
+                 const uint8_t* const data, const uint32_t len,
+                 const uint8_t*& out);
+
+  void clear(const Connection::ID id);
+
+private:
+  static constexpr uint32_t NIL = uint32_t(-1);
+
+  struct Entry
+  {
+    uint32_t m_seq;
+    uint32_t m_len;
+    uint32_t m_next;
+  };
+
+  inline uint8_t* buffer(const uint32_t idx) { return &m_data[idx * m_bufsz]; }
+
+  inline void release(const uint32_t idx) { m_free.push_back(idx); }
+
+  const size_t m_depth;
+  const size_t m_bufsz;
+  std::vector<Entry> m_entries;
+  std::vector<uint8_t> m_data;
+  std::vector<uint32_t> m_free;
+  std::vector<uint32_t> m_head;
+  std::vector<uint8_t> m_count;
+  std::vector<uint8_t> m_batch;
+};
+
+}}}
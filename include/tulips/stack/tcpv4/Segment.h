@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <tulips/stack/TCPv4.h>
+#include <tulips/system/Clock.h>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -39,40 +41,50 @@ public:
   Segment();
 
 private:
-  inline void set(const uint32_t len, const uint32_t seq, uint8_t* const dat)
+  inline void set(const uint32_t len, const uint32_t seq, uint8_t* const dat,
+                  const uint8_t hlen = HEADER_LEN)
   {
     m_len = len;
     m_seq = seq;
     m_dat = dat;
+    m_tms = 0;
+    m_sacked = false;
+    m_rexmit = false;
+    m_zcopy = false;
+    m_hlen = hlen;
+    m_summed = false;
   }
 
   inline void mark(const uint32_t seq) { m_seq = seq; }
 
-  inline void clear()
-  {
-    m_len = 0;
-    m_seq = 0;
-    m_dat = nullptr;
-  }
-
+  /*
+   * Move the segment to another buffer. The buffer of a segment that
+   * references the application data only holds the header.
+   */
   inline void swap(uint8_t* const to)
   {
-    memcpy(to, m_dat, m_len);
+    memcpy(to, m_dat, m_hlen + (m_zcopy ? 0 : m_len));
     m_dat = to;
   }
 
   /*
-   * The len field is used to check if the segment was fully acknowledged. It
-   * is also used to check if the segment is valid (=0).
+   * The len field is used to check if the segment was fully acknowledged.
    */
-  uint32_t m_len; // 4 - Length of the data that was sent
-  uint32_t m_seq; // 4 - Sequence number of the segment
-  uint8_t* m_dat; // 8 - Data that was sent
+  uint32_t m_len;             // 4 - Length of the data that was sent
+  uint32_t m_seq;             // 4 - Sequence number of the segment
+  uint8_t* m_dat;             // 8 - Data that was sent
+  system::Clock::Value m_tms; // 8 - Send timestamp, 0 once retransmitted
+  bool m_sacked;              // 1 - Segment was selectively acknowledged
+  bool m_rexmit;              // 1 - Segment was retransmitted during recovery
+  bool m_zcopy;               // 1 - Segment references the application data
+  uint8_t m_hlen;             // 1 - Length of the TCP header, with options
+  uint16_t m_sum;             // 2 - Checksum of the payload, once summed
+  bool m_summed;              // 1 - Payload of the segment has been summed
 
   friend class Connection;
   friend class Processor;
-} __attribute__((aligned(16)));
+} __attribute__((aligned(32)));
 
-static_assert(sizeof(Segment) == 16, "Invalid size for tcpv4::Segment");
+static_assert(sizeof(Segment) == 32, "Invalid size for tcpv4::Segment");
 
 }}}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <tulips/stack/IPv4.h>
+#include <tulips/stack/TCPv4.h>
+#include <tulips/system/Clock.h>
+#include <cstdint>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * SYN cookies. The initial sequence number of a SYN/ACK encodes the state of
+ * the handshake, so that no connection is allocated until the ACK that
+ * completes it comes back. The cookie is laid out as follows:
+ *
+ *   | 31 .. 29 | 28 .. 26 | 25 .. 22 | 21  | 20 .. 0 |
+ *   | counter  | MSS      | WSC      | SAP | hash    |
+ *
+ * A WSC value of 15 means that the peer did not send a window scale. The
+ * counter ticks every PERIOD seconds, and a cookie is valid for up to two
+ * ticks. The hash covers the connection tuple, the initial sequence number of
+ * the peer and the upper bits of the cookie, keyed with a random secret.
+ */
+class SynCookie
+{
+public:
+  /*
+   * Handshake state encoded in a cookie.
+   */
+  struct State
+  {
+    uint16_t mss;  // Maximum segment size, rounded down to the MSS table
+    uint8_t wsc;   // Window scale of the peer
+    bool wscok;    // The peer sent a window scale
+    bool sackperm; // The peer permits SACK
+  };
+
+  static constexpr uint32_t PERIOD = 64;
+
+  SynCookie();
+
+  /*
+   * Build the cookie for the SYN of sequence number seqno.
+   */
+  uint32_t make(ipv4::Address const& ripaddr, const Port rport,
+                const Port lport, const uint32_t seqno, State const& st,
+                const system::Clock::Value now) const;
+
+  /*
+   * Check the cookie acknowledged in response to the SYN of sequence number
+   * seqno, and decode its state. Return false if it is invalid or expired.
+   */
+  bool check(ipv4::Address const& ripaddr, const Port rport, const Port lport,
+             const uint32_t seqno, const uint32_t cookie,
+             const system::Clock::Value now, State& st) const;
+
+private:
+  uint32_t hash(ipv4::Address const& ripaddr, const Port rport,
+                const Port lport, const uint32_t seqno,
+                const uint32_t bits) const;
+
+  uint64_t m_secret[2];
+};
+
+}}}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <tulips/stack/tcpv4/Connection.h>
+#include <tulips/system/Clock.h>
+#include <cstdint>
+#include <vector>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Connection timers, kept in a binary min-heap ordered by deadline. Each
+ * connection has one timer of each kind. Deadlines are expressed in clock
+ * cycles.
+ *
+ * Pushing a timer to a later deadline only records that deadline. The heap
+ * entry is fixed up when it reaches the top of the heap. This keeps the cost
+ * of re-arming the retransmission timer on each ACK constant.
+ */
+class Timers
+{
+public:
+  enum Kind
+  {
+    REXMIT = 0,    // Retransmission timer
+    WAIT = 1,      // FIN_WAIT_2 and TIME_WAIT timer
+    PERSIST = 2,   // Zero window probe timer
+    KEEPALIVE = 3, // Idle connection probe timer
+    COUNT
+  };
+
+  Timers(const size_t nconn);
+
+  inline bool armed(const Connection::ID id, const Kind kind) const
+  {
+    return m_deadline[id * COUNT + kind] != 0;
+  }
+
+  inline system::Clock::Value deadline(const Connection::ID id,
+                                       const Kind kind) const
+  {
+    return m_deadline[id * COUNT + kind];
+  }
+
+  void arm(const Connection::ID id, const Kind kind,
+           const system::Clock::Value deadline);
+
+  inline void disarm(const Connection::ID id, const Kind kind)
+  {
+    m_deadline[id * COUNT + kind] = 0;
+  }
+
+  inline void clear(const Connection::ID id)
+  {
+    for (size_t k = 0; k < COUNT; k += 1) {
+      m_deadline[id * COUNT + k] = 0;
+    }
+  }
+
+  /*
+   * Pop the next timer that expired at time now. Return false if there is
+   * none. The timer is disarmed when it is returned.
+   */
+  bool expired(const system::Clock::Value now, Connection::ID& id, Kind& kind);
+
+private:
+  struct Entry
+  {
+    system::Clock::Value m_when;
+    uint32_t m_tid;
+  };
+
+  using Deadlines = std::vector<system::Clock::Value>;
+  using Positions = std::vector<uint32_t>;
+  using Heap = std::vector<Entry>;
+
+  static constexpr uint32_t NPOS = uint32_t(-1);
+
+  void up(uint32_t pos);
+  void down(uint32_t pos);
+  void pop();
+
+  Deadlines m_deadline;
+  Positions m_position;
+  Heap m_heap;
+};
+
+}}}
@@ -51,6 +51,7 @@ public:
   {
     VALIDATE_IP_CSUM = 0x1,
     VALIDATE_TCP_CSUM = 0x2,
+    RECEIVE_BURST = 0x4,
   };
 
   /*
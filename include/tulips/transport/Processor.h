@@ -32,6 +32,15 @@
 
 namespace tulips { namespace transport {
 
+/**
+ * A piece of incoming data in a burst.
+ */
+struct Frame
+{
+  uint16_t len;
+  const uint8_t* data;
+};
+
 class Processor
 {
 public:
@@ -58,6 +67,28 @@ public:
    * @return the status of the operation.
    */
   virtual Status process(const uint16_t len, const uint8_t* const data) = 0;
+
+  /**
+   * Process a burst of incoming pieces of data. Processors that can amortize
+   * their work across a burst override this method. By default, the pieces of
+   * data are processed one at a time.
+   *
+   * @param count the number of pieces of data.
+   * @param frames the pieces of data.
+   *
+   * @return the status of the operation, the first error if any.
+   */
+  virtual Status process(const uint16_t count, const Frame* const frames)
+  {
+    Status res = Status::Ok;
+    for (uint16_t i = 0; i < count; i += 1) {
+      Status ret = process(frames[i].len, frames[i].data);
+      if (ret != Status::Ok && res == Status::Ok) {
+        res = ret;
+      }
+    }
+    return res;
+  }
 };
 
 }}
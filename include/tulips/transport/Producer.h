@@ -28,7 +28,9 @@
 #pragma once
 
 #include <tulips/api/Status.h>
+#include <tulips/transport/Processor.h>
 #include <cstdint>
+#include <cstring>
 
 namespace tulips { namespace transport {
 
@@ -63,6 +65,32 @@ public:
    */
   virtual Status commit(const uint32_t len, uint8_t* const buf,
                         const uint16_t mss = 0) = 0;
+
+  /*
+   * Commit a prepared buffer holding the headers of a frame whose payload is
+   * made of fragments that live outside of the buffer. By default, the
+   * fragments are copied after the headers and the buffer is committed as a
+   * whole.
+   *
+   * @param len the length of the headers contained in the buffer.
+   * @param buf the previously prepared buffer.
+   * @param count the number of fragments.
+   * @param frags the fragments of payload.
+   * @param mss the mss to use in case of segmentation offload.
+   *
+   * @return the status of the operation.
+   */
+  virtual Status commitv(const uint32_t len, uint8_t* const buf,
+                         const uint16_t count, const Frame* const frags,
+                         const uint16_t mss = 0)
+  {
+    uint32_t off = len;
+    for (uint16_t i = 0; i < count; i += 1) {
+      memcpy(buf + off, frags[i].data, frags[i].len);
+      off += frags[i].len;
+    }
+    return commit(off, buf, mss);
+  }
 };
 
 }}
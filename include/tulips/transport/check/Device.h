@@ -81,10 +81,13 @@ public:
   Status prepare(uint8_t*& buf) override;
   Status commit(const uint32_t len, uint8_t* const buf,
                 const uint16_t mss = 0) override;
+  Status commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                 const Frame* const frags, const uint16_t mss = 0) override;
 
 private:
   Status run() override { return Status::Ok; }
   Status process(const uint16_t len, const uint8_t* const data) override;
+  Status process(const uint16_t count, const Frame* const frames) override;
 
   static bool check(const uint8_t* const data, const size_t len);
 
@@ -79,6 +79,8 @@ public:
   Status prepare(uint8_t*& buf) override;
   Status commit(const uint32_t len, uint8_t* const buf,
                 const uint16_t mss = 0) override;
+  Status commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                 const Frame* const frags, const uint16_t mss = 0) override;
 
 private:
   transport::Device& m_device;
@@ -43,8 +43,8 @@ class Device : public transport::Device
 public:
   static constexpr size_t EVENT_CLEANUP_THRESHOLD = 16;
   static constexpr size_t INLINE_DATA_THRESHOLD = 256;
+  static constexpr size_t MAX_SEND_SGE = 4;
 
-  static constexpr int POST_RECV_THRESHOLD = 32;
   static constexpr uint32_t RECV_BUFLEN = 2 * 1024;
 
   Device(const uint16_t nbuf);
@@ -75,12 +75,23 @@ public:
 
   Status prepare(uint8_t*& buf);
   Status commit(const uint32_t len, uint8_t* const buf, const uint16_t mss = 0);
+  Status commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                 const Frame* const frags, const uint16_t mss = 0);
+
+  /*
+   * Register the memory holding data sent without copy. Fragments that live in
+   * registered memory are handed to the NIC as is, others are copied.
+   */
+  Status registerMemory(const void* const addr, const size_t len);
+  Status unregisterMemory(const void* const addr);
 
 private:
   using Filters = std::map<uint16_t, ibv_exp_flow*>;
+  using Regions = std::map<uintptr_t, ibv_mr*>;
 
   void construct(std::string const& ifn, const uint16_t nbuf);
   Status postReceive(const int id);
+  ibv_mr* lookup(const uint8_t* const data, const size_t len) const;
 
   uint16_t m_nbuf;
   uint16_t m_pending;
@@ -107,6 +118,7 @@ private:
   ibv_flow* m_bcast;
   ibv_flow* m_flow;
   Filters m_filters;
+  Regions m_regions;
 };
 
 }}}
@@ -29,6 +29,7 @@
 
 #include <tulips/transport/Device.h>
 #include <string>
+#include <vector>
 
 #ifdef __OpenBSD__
 #include <pcap.h>
@@ -89,15 +90,19 @@ public:
   Status prepare(uint8_t*& buf) override;
   Status commit(const uint32_t len, uint8_t* const buf,
                 const uint16_t mss = 0) override;
+  Status commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                 const Frame* const frags, const uint16_t mss = 0) override;
 
 private:
   Status run() override { return Status::Ok; }
   Status process(const uint16_t len, const uint8_t* const data) override;
+  Status process(const uint16_t count, const Frame* const frames) override;
 
   transport::Device& m_device;
   pcap_t* m_pcap;
   pcap_dumper_t* m_pcap_dumper;
   Processor* m_proc;
+  std::vector<uint8_t> m_gather;
 };
 
 }}}
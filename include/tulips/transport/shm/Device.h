@@ -42,6 +42,11 @@ namespace tulips { namespace transport { namespace shm {
 class Device : public transport::Device
 {
 public:
+  /*
+   * Maximum number of packets processed at once with RECEIVE_BURST.
+   */
+  static constexpr size_t BURST_SIZE = 32;
+
   Device(stack::ethernet::Address const& address,
          stack::ipv4::Address const& ip, stack::ipv4::Address const& dr,
          stack::ipv4::Address const& nm, tulips_fifo_t rf, tulips_fifo_t wf);
@@ -105,6 +110,7 @@ private:
 
 protected:
   bool waitForInput(const uint64_t ns);
+  Status process(Processor& proc);
 
   stack::ethernet::Address m_address;
   stack::ipv4::Address m_ip;
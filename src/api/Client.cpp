@@ -314,6 +314,52 @@ Client::send(const ID id, const uint32_t len, const uint8_t* const data,
   return m_tcp.send(c.conn, len, data, off);
 }
 
+Status
+Client::sendv(const ID id, const struct iovec* const iov, const size_t count,
+              uint32_t& off)
+{
+  /*
+   * Check if connection ID is valid.
+   */
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_cns[id];
+  /*
+   * Send the fragments.
+   */
+#ifdef TULIPS_ENABLE_LATENCY_MONITOR
+  c.pre = c.pre ?: system::Clock::read();
+#endif
+  return m_tcp.sendv(c.conn, iov, count, off);
+}
+
+Status
+Client::setReceiveBuffer(const ID id, const uint32_t len)
+{
+  /*
+   * Check if connection ID is valid.
+   */
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_cns[id];
+  return m_tcp.setReceiveBuffer(c.conn, len);
+}
+
+Status
+Client::consume(const ID id, const uint32_t len)
+{
+  /*
+   * Check if connection ID is valid.
+   */
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_cns[id];
+  return m_tcp.consume(c.conn, len);
+}
+
 Status
 Client::get(const ID id, stack::ipv4::Address& ripaddr,
             stack::tcpv4::Port& lport, stack::tcpv4::Port& rport)
@@ -383,7 +429,7 @@ Client::onConnected(tcpv4::Connection& c)
     CLIENT_LOG("invalid connection for handle " << c.id() << ", ignoring");
     return;
   }
-  uint8_t options = 0;
+  uint16_t options = 0;
   d.state = Connection::State::Connected;
   c.setCookie(m_delegate.onConnected(id, nullptr, options));
   c.setOptions(options);
@@ -511,4 +557,31 @@ Client::onNewData(stack::tcpv4::Connection& c, const uint8_t* const data,
   return m_delegate.onNewData(id, c.cookie(), data, len, alen, sdata, slen);
 }
 
+Action
+Client::onNewData(stack::tcpv4::Connection& c,
+                  const transport::Frame* const frags, const size_t count)
+{
+  ID id = m_idx[c.id()];
+  Connection& d = m_cns[id];
+  if (d.conn != c.id()) {
+    CLIENT_LOG("invalid connection for handle " << c.id() << ", ignoring");
+    return Action::Abort;
+  }
+  return m_delegate.onNewData(id, c.cookie(), frags, count);
+}
+
+Action
+Client::onNewData(stack::tcpv4::Connection& c,
+                  const transport::Frame* const frags, const size_t count,
+                  const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+{
+  ID id = m_idx[c.id()];
+  Connection& d = m_cns[id];
+  if (d.conn != c.id()) {
+    CLIENT_LOG("invalid connection for handle " << c.id() << ", ignoring");
+    return Action::Abort;
+  }
+  return m_delegate.onNewData(id, c.cookie(), frags, count, alen, sdata, slen);
+}
+
 }
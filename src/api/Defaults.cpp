@@ -32,7 +32,7 @@ namespace tulips { namespace defaults {
 
 void*
 ClientDelegate::onConnected(UNUSED Client::ID const& id,
-                            UNUSED void* const cookie, UNUSED uint8_t& opts)
+                            UNUSED void* const cookie, UNUSED uint16_t& opts)
 {
   return nullptr;
 }
@@ -76,7 +76,7 @@ ClientDelegate::onClosed(UNUSED Client::ID const& id, UNUSED void* const cookie)
 
 void*
 ServerDelegate::onConnected(UNUSED Server::ID const& id,
-                            UNUSED void* const cookie, UNUSED uint8_t& opts)
+                            UNUSED void* const cookie, UNUSED uint16_t& opts)
 {
   return nullptr;
 }
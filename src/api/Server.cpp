@@ -133,6 +133,25 @@ Server::send(const ID id, const uint32_t len, const uint8_t* const data,
   return m_tcp.send(id, len, data, off);
 }
 
+Status
+Server::sendv(const ID id, const struct iovec* const iov, const size_t count,
+              uint32_t& off)
+{
+  return m_tcp.sendv(id, iov, count, off);
+}
+
+Status
+Server::setReceiveBuffer(const ID id, const uint32_t len)
+{
+  return m_tcp.setReceiveBuffer(id, len);
+}
+
+Status
+Server::consume(const ID id, const uint32_t len)
+{
+  return m_tcp.consume(id, len);
+}
+
 void*
 Server::cookie(const ID id) const
 {
@@ -142,7 +161,7 @@ Server::cookie(const ID id) const
 void
 Server::onConnected(tcpv4::Connection& c)
 {
-  uint8_t opts = 0;
+  uint16_t opts = 0;
   void* srvdata = m_cookies[c.localPort()];
   void* appdata = m_delegate.onConnected(c.id(), srvdata, opts);
   SERVER_LOG("connection " << c.id() << " connected");
@@ -200,4 +219,20 @@ Server::onNewData(stack::tcpv4::Connection& c, const uint8_t* const data,
   return m_delegate.onNewData(c.id(), c.cookie(), data, len, alen, sdata, slen);
 }
 
+Action
+Server::onNewData(stack::tcpv4::Connection& c,
+                  const transport::Frame* const frags, const size_t count)
+{
+  return m_delegate.onNewData(c.id(), c.cookie(), frags, count);
+}
+
+Action
+Server::onNewData(stack::tcpv4::Connection& c,
+                  const transport::Frame* const frags, const size_t count,
+                  const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+{
+  return m_delegate.onNewData(c.id(), c.cookie(), frags, count, alen, sdata,
+                              slen);
+}
+
 }
@@ -86,7 +86,7 @@ public:
   Delegate(const bool nodelay) : m_nodelay(nodelay) {}
 
   void* onConnected(UNUSED tulips::Client::ID const& id,
-                    UNUSED void* const cookie, uint8_t& opts) override
+                    UNUSED void* const cookie, uint16_t& opts) override
   {
     opts = m_nodelay ? tcpv4::Connection::NO_DELAY : 0;
     return nullptr;
@@ -300,6 +300,61 @@ Client::send(const ID id, const uint32_t len, const uint8_t* const data,
   return flush(id, cookie);
 }
 
+Status
+Client::sendv(const ID id, const struct iovec* const iov, const size_t count,
+              uint32_t& off)
+{
+  /*
+   * Grab the context.
+   */
+  void* cookie = m_client.cookie(id);
+  if (cookie == nullptr) {
+    return Status::InvalidArgument;
+  }
+  Context& c = *reinterpret_cast<Context*>(cookie);
+  /*
+   * Check if the connection is in the right state.
+   */
+  if (c.state != Context::State::Ready) {
+    return Status::InvalidConnection;
+  }
+  /*
+   * Check if we can write anything.
+   */
+  if (c.blocked) {
+    return Status::OperationInProgress;
+  }
+  /*
+   * Write the fragments. With BIO mem, the writes will always succeed.
+   */
+  off = 0;
+  for (size_t i = 0; i < count; i += 1) {
+    if (iov[i].iov_len != 0) {
+      off += SSL_write(c.ssl, iov[i].iov_base, iov[i].iov_len);
+    }
+  }
+  /*
+   * Flush the data.
+   */
+  return flush(id, cookie);
+}
+
+Status
+Client::setReceiveBuffer(UNUSED const ID id, UNUSED const uint32_t len)
+{
+  /*
+   * The ciphertext is consumed as it is decrypted, which does not match what
+   * the application consumes.
+   */
+  return Status::UnsupportedOperation;
+}
+
+Status
+Client::consume(UNUSED const ID id, UNUSED const uint32_t len)
+{
+  return Status::UnsupportedOperation;
+}
+
 system::Clock::Value
 Client::averageLatency(const ID id)
 {
@@ -307,7 +362,7 @@ Client::averageLatency(const ID id)
 }
 
 void*
-Client::onConnected(ID const& id, void* const cookie, uint8_t& opts)
+Client::onConnected(ID const& id, void* const cookie, uint16_t& opts)
 {
   void* user = m_delegate.onConnected(id, cookie, opts);
   auto* c = new Context(AS_SSL(m_context), m_dev.mss(), user);
@@ -377,6 +432,35 @@ Client::onNewData(ID const& id, void* const cookie, const uint8_t* const data,
   return c.onNewData(id, m_delegate, data, len, alen, sdata, slen);
 }
 
+Action
+Client::onNewData(ID const& id, void* const cookie,
+                  const transport::Frame* const frags, const size_t count)
+{
+  /*
+   * Grab the context.
+   */
+  Context& c = *reinterpret_cast<Context*>(cookie);
+  /*
+   * Write the fragments in the input BIO.
+   */
+  return c.onNewData(id, m_delegate, frags, count);
+}
+
+Action
+Client::onNewData(ID const& id, void* const cookie,
+                  const transport::Frame* const frags, const size_t count,
+                  const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+{
+  /*
+   * Grab the context.
+   */
+  Context& c = *reinterpret_cast<Context*>(cookie);
+  /*
+   * Write the fragments in the input BIO.
+   */
+  return c.onNewData(id, m_delegate, frags, count, alen, sdata, slen);
+}
+
 void
 Client::onClosed(ID const& id, void* const cookie)
 {
@@ -107,16 +107,95 @@ struct Context
   }
 
   /**
-   * Processing incoming data and encrypt the response.
+   * Processing incoming data.
    */
   template<typename ID>
   Action onNewData(ID const& id, interface::Delegate<ID>& delegate,
                    const uint8_t* const data, const uint32_t len)
   {
-    /*
-     * Write the data in the input BIO.
-     */
     BIO_write(bin, data, len);
+    return decrypt(id, delegate, len);
+  }
+
+  /**
+   * Processing incoming fragments. They are all written in the input BIO and
+   * decrypted at once.
+   */
+  template<typename ID>
+  Action onNewData(ID const& id, interface::Delegate<ID>& delegate,
+                   const transport::Frame* const frags, const size_t count)
+  {
+    return decrypt(id, delegate, write(frags, count));
+  }
+
+  /**
+   * Processing incoming data and encrypt the response.
+   */
+  template<typename ID>
+  Action onNewData(ID const& id, interface::Delegate<ID>& delegate,
+                   const uint8_t* const data, const uint32_t len,
+                   const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+  {
+    BIO_write(bin, data, len);
+    return decrypt(id, delegate, len, alen, sdata, slen);
+  }
+
+  /**
+   * Processing incoming fragments and encrypt the response. The fragments are
+   * all written in the input BIO and decrypted at once.
+   */
+  template<typename ID>
+  Action onNewData(ID const& id, interface::Delegate<ID>& delegate,
+                   const transport::Frame* const frags, const size_t count,
+                   const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+  {
+    return decrypt(id, delegate, write(frags, count), alen, sdata, slen);
+  }
+
+  /**
+   * Return how much data is pending on the write channel.
+   */
+  inline size_t pending() { return BIO_ctrl_pending(bout); }
+
+  /**
+   * Handle delegate response.
+   */
+  Action abortOrClose(const Action r, const uint32_t alen, uint8_t* const sdata,
+                      uint32_t& slen);
+
+  /**
+   * Flush any data pending in the write channel.
+   */
+  Action flush(const uint32_t alen, uint8_t* const sdata, uint32_t& slen);
+
+  BIO* bin;
+  BIO* bout;
+  SSL* ssl;
+  State state;
+  void* cookie;
+  bool blocked;
+
+private:
+  /**
+   * Write fragments in the input BIO, and return their total length.
+   */
+  inline uint32_t write(const transport::Frame* const frags, const size_t count)
+  {
+    uint32_t len = 0;
+    for (size_t i = 0; i < count; i += 1) {
+      BIO_write(bin, frags[i].data, frags[i].len);
+      len += frags[i].len;
+    }
+    return len;
+  }
+
+  /**
+   * Decrypt the data written in the input BIO and pass it to the delegate.
+   */
+  template<typename ID>
+  Action decrypt(ID const& id, interface::Delegate<ID>& delegate,
+                 const uint32_t len)
+  {
     /*
      * Only accept Ready state.
      */
@@ -172,17 +251,14 @@ struct Context
   }
 
   /**
-   * Processing incoming data and encrypt the response.
+   * Decrypt the data written in the input BIO, pass it to the delegate and
+   * encrypt the response.
    */
   template<typename ID>
-  Action onNewData(ID const& id, interface::Delegate<ID>& delegate,
-                   const uint8_t* const data, const uint32_t len,
-                   const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+  Action decrypt(ID const& id, interface::Delegate<ID>& delegate,
+                 const uint32_t len, const uint32_t alen, uint8_t* const sdata,
+                 uint32_t& slen)
   {
-    /*
-     * Write the data in the input BIO.
-     */
-    BIO_write(bin, data, len);
     /*
      * Check the connection's state.
      */
@@ -322,29 +398,6 @@ struct Context
 #endif
 #endif
   }
-
-  /**
-   * Return how much data is pending on the write channel.
-   */
-  inline size_t pending() { return BIO_ctrl_pending(bout); }
-
-  /**
-   * Handle delegate response.
-   */
-  Action abortOrClose(const Action r, const uint32_t alen, uint8_t* const sdata,
-                      uint32_t& slen);
-
-  /**
-   * Flush any data pending in the write channel.
-   */
-  Action flush(const uint32_t alen, uint8_t* const sdata, uint32_t& slen);
-
-  BIO* bin;
-  BIO* bout;
-  SSL* ssl;
-  State state;
-  void* cookie;
-  bool blocked;
 };
 
 }}
@@ -195,8 +195,63 @@ Server::send(const ID id, const uint32_t len, const uint8_t* const data,
   return flush(id, cookie);
 }
 
+Status
+Server::sendv(const ID id, const struct iovec* const iov, const size_t count,
+              uint32_t& off)
+{
+  /*
+   * Grab the context.
+   */
+  void* cookie = m_server.cookie(id);
+  if (cookie == nullptr) {
+    return Status::InvalidArgument;
+  }
+  Context& c = *reinterpret_cast<Context*>(cookie);
+  /*
+   * Check if the connection is in the right state.
+   */
+  if (c.state != Context::State::Ready) {
+    return Status::InvalidConnection;
+  }
+  /*
+   * Check if we can write anything.
+   */
+  if (c.blocked) {
+    return Status::OperationInProgress;
+  }
+  /*
+   * Write the fragments. With BIO mem, the writes will always succeed.
+   */
+  off = 0;
+  for (size_t i = 0; i < count; i += 1) {
+    if (iov[i].iov_len != 0) {
+      off += SSL_write(c.ssl, iov[i].iov_base, iov[i].iov_len);
+    }
+  }
+  /*
+   * Flush the data.
+   */
+  return flush(id, cookie);
+}
+
+Status
+Server::setReceiveBuffer(UNUSED const ID id, UNUSED const uint32_t len)
+{
+  /*
+   * The ciphertext is consumed as it is decrypted, which does not match what
+   * the application consumes.
+   */
+  return Status::UnsupportedOperation;
+}
+
+Status
+Server::consume(UNUSED const ID id, UNUSED const uint32_t len)
+{
+  return Status::UnsupportedOperation;
+}
+
 void*
-Server::onConnected(ID const& id, void* const cookie, uint8_t& opts)
+Server::onConnected(ID const& id, void* const cookie, uint16_t& opts)
 {
   void* user = m_delegate.onConnected(id, cookie, opts);
   auto* c = new Context(AS_SSL(m_context), m_dev.mss(), user);
@@ -266,6 +321,35 @@ Server::onNewData(ID const& id, void* const cookie, const uint8_t* const data,
   return c.onNewData(id, m_delegate, data, len, alen, sdata, slen);
 }
 
+Action
+Server::onNewData(ID const& id, void* const cookie,
+                  const transport::Frame* const frags, const size_t count)
+{
+  /*
+   * Grab the context.
+   */
+  Context& c = *reinterpret_cast<Context*>(cookie);
+  /*
+   * Write the fragments in the input BIO.
+   */
+  return c.onNewData(id, m_delegate, frags, count);
+}
+
+Action
+Server::onNewData(ID const& id, void* const cookie,
+                  const transport::Frame* const frags, const size_t count,
+                  const uint32_t alen, uint8_t* const sdata, uint32_t& slen)
+{
+  /*
+   * Grab the context.
+   */
+  Context& c = *reinterpret_cast<Context*>(cookie);
+  /*
+   * Write the fragments in the input BIO.
+   */
+  return c.onNewData(id, m_delegate, frags, count, alen, sdata, slen);
+}
+
 void
 Server::onClosed(ID const& id, void* const cookie)
 {
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tulips/stack/Utils.h>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHECKSUM_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define CHECKSUM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace tulips { namespace stack { namespace utils {
+
+namespace {
+
+/*
+ * Fold a sum of 16-bit words into 16 bits, with the end-around carry. The
+ * result is only 0 if the sum is.
+ */
+inline uint16_t
+fold(uint64_t sum)
+{
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return sum;
+}
+
+/*
+ * Sum the 16-bit words of a buffer in host byte order, 8 bytes at a time. The
+ * last byte of an odd length buffer is padded with zero.
+ */
+inline uint64_t
+sum(uint64_t acc, const uint8_t* data, size_t len)
+{
+  while (len >= 8) {
+    uint64_t w;
+    memcpy(&w, data, sizeof(w));
+    acc += (w & 0xFFFFFFFF) + (w >> 32);
+    data += 8;
+    len -= 8;
+  }
+  while (len >= 2) {
+    uint16_t w;
+    memcpy(&w, data, sizeof(w));
+    acc += w;
+    data += 2;
+    len -= 2;
+  }
+  if (len > 0) {
+    uint8_t pad[2] = { data[0], 0 };
+    uint16_t w;
+    memcpy(&w, pad, sizeof(w));
+    acc += w;
+  }
+  return acc;
+}
+
+/*
+ * Fold a sum in host byte order, convert it to network byte order (RFC 1071
+ * 2.(B)) and add the seed.
+ */
+inline uint16_t
+finish(const uint16_t seed, const uint64_t acc)
+{
+  uint16_t res = fold(acc);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  res = __builtin_bswap16(res);
+#endif
+  return fold((uint64_t)res + seed);
+}
+
+/*
+ * Reference kernel, one word at a time.
+ */
+uint16_t
+checksumScalar(const uint16_t seed, const uint8_t* const data,
+               const uint16_t len)
+{
+  uint16_t t, sum = seed;
+  const uint8_t* dataptr = data;
+  const uint8_t* last_byte = data + len - 1;
+  /*
+   * If at least two more bytes.
+   */
+  while (dataptr < last_byte) {
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if (sum < t) {
+      sum++;
+    }
+    dataptr += 2;
+  }
+  if (dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if (sum < t) {
+      sum++;
+    }
+  }
+  /*
+   * Return sum in host byte order
+   */
+  return sum;
+}
+
+/*
+ * Portable kernel, with 64-bit accumulation.
+ */
+uint16_t
+checksumGeneric(const uint16_t seed, const uint8_t* const data,
+                const uint16_t len)
+{
+  return finish(seed, sum(0, data, len));
+}
+
+#ifdef CHECKSUM_X86
+
+/*
+ * SSE2 kernel. The words are widened to 32-bit lanes, which cannot overflow
+ * for a 64KB buffer.
+ */
+__attribute__((target("sse2"))) uint16_t
+checksumSSE2(const uint16_t seed, const uint8_t* const data,
+             const uint16_t len)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc0 = zero, acc1 = zero;
+  const uint8_t* p = data;
+  size_t n = len;
+  /*
+   * Sum 32 bytes at a time, in two independent accumulators.
+   */
+  while (n >= 32) {
+    __m128i v0 = _mm_loadu_si128((const __m128i*)p);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)(p + 16));
+    acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(v0, zero));
+    acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(v0, zero));
+    acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(v1, zero));
+    acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(v1, zero));
+    p += 32;
+    n -= 32;
+  }
+  /*
+   * Add the lanes up and sum the remaining bytes.
+   */
+  uint32_t lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, _mm_add_epi32(acc0, acc1));
+  uint64_t acc = (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  return finish(seed, sum(acc, p, n));
+}
+
+/*
+ * AVX2 kernel. Same as the SSE2 kernel, with 256-bit vectors.
+ */
+__attribute__((target("avx2"))) uint16_t
+checksumAVX2(const uint16_t seed, const uint8_t* const data,
+             const uint16_t len)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero, acc1 = zero;
+  const uint8_t* p = data;
+  size_t n = len;
+  /*
+   * Sum 64 bytes at a time, in two independent accumulators.
+   */
+  while (n >= 64) {
+    __m256i v0 = _mm256_loadu_si256((const __m256i*)p);
+    __m256i v1 = _mm256_loadu_si256((const __m256i*)(p + 32));
+    acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v0, zero));
+    acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v0, zero));
+    acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v1, zero));
+    acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v1, zero));
+    p += 64;
+    n -= 64;
+  }
+  /*
+   * Add the lanes up and sum the remaining bytes.
+   */
+  uint32_t lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi32(acc0, acc1));
+  uint64_t acc = 0;
+  for (size_t i = 0; i < 8; i += 1) {
+    acc += lanes[i];
+  }
+  return finish(seed, sum(acc, p, n));
+}
+
+#endif
+
+#ifdef CHECKSUM_NEON
+
+/*
+ * NEON kernel. The words are added pairwise into 32-bit lanes.
+ */
+uint16_t
+checksumNEON(const uint16_t seed, const uint8_t* const data,
+             const uint16_t len)
+{
+  uint32x4_t acc0 = vdupq_n_u32(0), acc1 = vdupq_n_u32(0);
+  const uint8_t* p = data;
+  size_t n = len;
+  /*
+   * Sum 32 bytes at a time, in two independent accumulators.
+   */
+  while (n >= 32) {
+    acc0 = vpadalq_u16(acc0, vreinterpretq_u16_u8(vld1q_u8(p)));
+    acc1 = vpadalq_u16(acc1, vreinterpretq_u16_u8(vld1q_u8(p + 16)));
+    p += 32;
+    n -= 32;
+  }
+  /*
+   * Add the lanes up and sum the remaining bytes.
+   */
+  uint64_t acc = vaddlvq_u32(acc0) + vaddlvq_u32(acc1);
+  return finish(seed, sum(acc, p, n));
+}
+
+#endif
+
+/*
+ * Kernel selection. The kernel is resolved on the first call to checksum().
+ */
+uint16_t resolve(const uint16_t seed, const uint8_t* const data,
+                 const uint16_t len);
+
+std::atomic<ChecksumKernel::Function> s_checksum(resolve);
+
+uint16_t
+resolve(const uint16_t seed, const uint8_t* const data, const uint16_t len)
+{
+  ChecksumKernel::Function fn = checksumKernels().back().function;
+  s_checksum.store(fn, std::memory_order_relaxed);
+  return fn(seed, data, len);
+}
+
+}
+
+uint16_t
+checksum(const uint16_t seed, const uint8_t* const data, const uint16_t len)
+{
+  return s_checksum.load(std::memory_order_relaxed)(seed, data, len);
+}
+
+std::vector<ChecksumKernel>
+checksumKernels()
+{
+  std::vector<ChecksumKernel> res;
+  res.push_back({ "scalar", checksumScalar });
+  res.push_back({ "generic", checksumGeneric });
+#ifdef CHECKSUM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    res.push_back({ "sse2", checksumSSE2 });
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    res.push_back({ "avx2", checksumAVX2 });
+  }
+#endif
+#ifdef CHECKSUM_NEON
+  res.push_back({ "neon", checksumNEON });
+#endif
+  return res;
+}
+
+}}}
@@ -34,36 +34,6 @@
 
 namespace tulips { namespace stack { namespace utils {
 
-uint16_t
-checksum(const uint16_t seed, const uint8_t* const data, const uint16_t len)
-{
-  uint16_t t, sum = seed;
-  const uint8_t* dataptr = data;
-  const uint8_t* last_byte = data + len - 1;
-  /*
-   * If at least two more bytes.
-   */
-  while (dataptr < last_byte) {
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if (sum < t) {
-      sum++;
-    }
-    dataptr += 2;
-  }
-  if (dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if (sum < t) {
-      sum++;
-    }
-  }
-  /*
-   * Return sum in host byte order
-   */
-  return sum;
-}
-
 #define HEXFMT(_n) "0x" << std::hex << std::setw(_n) << std::setfill('0')
 #define RSTFMT std::dec << std::setfill(' ')
 
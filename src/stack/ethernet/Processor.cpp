@@ -146,4 +146,36 @@ Processor::process(const uint16_t len, const uint8_t* const data)
   return ret;
 }
 
+Status
+Processor::process(const uint16_t count, const transport::Frame* const frames)
+{
+  ETH_LOG("processing burst: " << count << " frames");
+  Status res = Status::Ok;
+  /**
+   * Let the protocol state know that a burst is starting.
+   */
+  if (m_ipv4) {
+    m_ipv4->begin();
+  }
+  /**
+   * Process the frames, without going through the virtual dispatch.
+   */
+  for (uint16_t i = 0; i < count; i += 1) {
+    Status ret = Processor::process(frames[i].len, frames[i].data);
+    if (ret != Status::Ok && res == Status::Ok) {
+      res = ret;
+    }
+  }
+  /**
+   * Flush the protocol state once for the whole burst.
+   */
+  if (m_ipv4) {
+    Status ret = m_ipv4->flush();
+    if (ret != Status::Ok && res == Status::Ok) {
+      res = ret;
+    }
+  }
+  return res;
+}
+
 }}}
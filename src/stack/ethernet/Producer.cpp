@@ -26,6 +26,7 @@
  */
 
 #include <tulips/stack/ethernet/Producer.h>
+#include <cstring>
 #include <arpa/inet.h>
 
 #define ETH_VERBOSE 0
@@ -67,6 +68,38 @@ Producer::prepare(uint8_t*& buf)
   return ret;
 }
 
+Status
+Producer::prepare(uint8_t*& buf, const uint8_t* const hdr, const uint16_t len)
+{
+  /*
+   * Grab a buffer
+   */
+  uint8_t* tmp;
+  Status ret = m_prod.prepare(tmp);
+  if (ret != Status::Ok) {
+    return ret;
+  }
+  /*
+   * Copy the headers
+   */
+  memcpy(tmp, hdr, len);
+  /*
+   * Advance that buffer
+   */
+  buf = tmp + HEADER_LEN;
+  return ret;
+}
+
+void
+Producer::header(Address const& dst, const uint16_t type,
+                 uint8_t* const buf) const
+{
+  auto* hdr = reinterpret_cast<Header*>(buf);
+  hdr->src = m_hostAddress;
+  hdr->dest = dst;
+  hdr->type = htons(type);
+}
+
 Status
 Producer::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
 {
@@ -74,4 +107,12 @@ Producer::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
   return m_prod.commit(len + HEADER_LEN, buf - HEADER_LEN, mss);
 }
 
+Status
+Producer::commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                  const transport::Frame* const frags, const uint16_t mss)
+{
+  ETH_LOG("committing frame: " << len << "B, " << count << " fragments");
+  return m_prod.commitv(len + HEADER_LEN, buf - HEADER_LEN, count, frags, mss);
+}
+
 }}}
@@ -101,6 +101,7 @@ Processor::process(const uint16_t UNUSED len, const uint8_t* const data)
    * Update the IP and Ethernet attributes.
    */
   m_ip4out.setProtocol(ipv4::PROTO_ICMP);
+  m_ip4out.setTypeOfService(0);
   m_ip4out.setDestinationAddress(m_ip4in->sourceAddress());
   m_ethout.setDestinationAddress(m_ethin->sourceAddress());
   /*
@@ -62,6 +62,7 @@ Request::operator()(ipv4::Address const& dst)
    */
   m_ip4.setDestinationAddress(dst);
   m_ip4.setProtocol(ipv4::PROTO_ICMP);
+  m_ip4.setTypeOfService(0);
   /*
    * Grab a send buffer
    */
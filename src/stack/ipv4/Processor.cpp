@@ -50,6 +50,7 @@ Processor::Processor(Address const& ha)
   , m_srceAddress()
   , m_destAddress()
   , m_proto(0)
+  , m_tos(0)
   , m_stats()
   , m_eth(nullptr)
 #ifdef TULIPS_ENABLE_RAW
@@ -84,6 +85,23 @@ Processor::run()
   return ret;
 }
 
+void
+Processor::begin()
+{
+  if (m_tcp) {
+    m_tcp->begin();
+  }
+}
+
+Status
+Processor::flush()
+{
+  if (m_tcp) {
+    return m_tcp->flush();
+  }
+  return Status::Ok;
+}
+
 Status
 Processor::process(const uint16_t UNUSED len, const uint8_t* const data)
 {
@@ -138,6 +156,7 @@ Processor::process(const uint16_t UNUSED len, const uint8_t* const data)
   m_srceAddress = INIP->srcipaddr;
   m_destAddress = INIP->destipaddr;
   m_proto = INIP->proto;
+  m_tos = INIP->tos;
   /*
    * Call the processors
    */
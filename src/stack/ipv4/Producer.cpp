@@ -41,6 +41,7 @@ Producer::Producer(ethernet::Producer& prod, Address const& ha)
   , m_defaultRouterAddress()
   , m_netMask(Address::BROADCAST)
   , m_proto(0)
+  , m_tos(0)
   , m_ipid(0)
   , m_stats()
 {
@@ -70,7 +71,7 @@ Producer::prepare(uint8_t*& buf)
    * Prepare the content of the header
    */
   OUTIP->vhl = 0x45;
-  OUTIP->tos = 0;
+  OUTIP->tos = m_tos;
   OUTIP->len = HEADER_LEN;
   OUTIP->ipid = htons(m_ipid);
   OUTIP->ipoffset[0] = 0;
@@ -87,6 +88,53 @@ Producer::prepare(uint8_t*& buf)
   return ret;
 }
 
+Status
+Producer::prepare(uint8_t*& buf, const uint8_t* const hdr, const uint16_t len,
+                  const uint8_t tos)
+{
+  /*
+   * Grab a buffer with the headers
+   */
+  uint8_t* outdata;
+  Status ret = m_eth.prepare(outdata, hdr, len);
+  if (ret != Status::Ok) {
+    return ret;
+  }
+  /*
+   * Update state.
+   */
+  m_ipid += 1;
+  /*
+   * Patch the content of the header
+   */
+  OUTIP->tos = tos;
+  OUTIP->ipid = htons(m_ipid);
+  /*
+   * Advance the buffer
+   */
+  buf = outdata + HEADER_LEN;
+  return ret;
+}
+
+void
+Producer::header(ethernet::Address const& hwdst, Address const& dst,
+                 const uint8_t proto, uint8_t* const buf) const
+{
+  m_eth.header(hwdst, ethernet::ETHTYPE_IP, buf);
+  uint8_t* outdata = buf + ethernet::HEADER_LEN;
+  OUTIP->vhl = 0x45;
+  OUTIP->tos = 0;
+  OUTIP->len = HEADER_LEN;
+  OUTIP->ipid = 0;
+  OUTIP->ipoffset[0] = 0;
+  OUTIP->ipoffset[1] = 0;
+  OUTIP->ttl = TTL;
+  OUTIP->proto = proto;
+  OUTIP->ipchksum = 0;
+  OUTIP->srcipaddr = m_hostAddress;
+  OUTIP->destipaddr = dst;
+}
+
 Status
 Producer::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
 {
@@ -109,4 +157,30 @@ Producer::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
   return m_eth.commit(outlen, outdata, mss);
 }
 
+Status
+Producer::commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                  const transport::Frame* const frags, const uint16_t mss)
+{
+  uint8_t* outdata = buf - HEADER_LEN;
+  uint32_t outlen = len + HEADER_LEN;
+  /*
+   * Fill in the remaining header fields, accounting for the fragments.
+   */
+  for (uint16_t i = 0; i < count; i += 1) {
+    outlen += frags[i].len;
+  }
+  OUTIP->len = htons(outlen);
+  /*
+   * Compute the checksum
+   */
+#ifndef TULIPS_HAS_HW_CHECKSUM
+  OUTIP->ipchksum = ~checksum(outdata);
+#endif
+  /*
+   * Commit the buffer.
+   */
+  m_stats.sent += 1;
+  return m_eth.commitv(len + HEADER_LEN, outdata, count, frags, mss);
+}
+
 }}}
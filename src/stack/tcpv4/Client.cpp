@@ -39,70 +39,69 @@
 
 namespace tulips { namespace stack { namespace tcpv4 {
 
+/*
+ * Copy len bytes starting at offset off in the concatenation of the fragments.
+ */
+static void
+gather(uint8_t* const dst, const struct iovec* const iov, const size_t count,
+       const uint32_t off, const uint32_t len)
+{
+  size_t i = 0;
+  uint32_t base = 0, done = 0;
+  /*
+   * Skip the fragments located before the offset.
+   */
+  while (i < count && base + iov[i].iov_len <= off) {
+    base += iov[i].iov_len;
+    i += 1;
+  }
+  /*
+   * Copy the fragments until the requested length is reached.
+   */
+  uint32_t skip = off - base;
+  while (i < count && done < len) {
+    uint32_t flen = iov[i].iov_len - skip;
+    if (flen > len - done) {
+      flen = len - done;
+    }
+    const uint8_t* src = static_cast<const uint8_t*>(iov[i].iov_base);
+    memcpy(dst + done, src + skip, flen);
+    done += flen;
+    skip = 0;
+    i += 1;
+  }
+}
+
 Status
 Processor::connect(ethernet::Address const& rhwaddr,
                    ipv4::Address const& ripaddr, const Port rport,
                    Connection::ID& id)
 {
   Port lport = 0;
-  Connections::iterator e;
-  /*
-   * Update IP and Ethernet attributes
-   */
-  m_ipv4to.setProtocol(ipv4::PROTO_TCP);
-  m_ipv4to.setDestinationAddress(ripaddr);
-  m_ethto.setDestinationAddress(rhwaddr);
+  Connection* e;
   /*
-   * Allocate a send buffer
+   * Allocate a new connection
    */
-  uint8_t* outdata;
-  Status ret = m_ipv4to.prepare(outdata);
-  if (ret != Status::Ok) {
-    return ret;
+  e = acquire();
+  if (e == nullptr) {
+    return Status::NoMoreResources;
   }
   /*
    * Find an unused local port
    */
-  do {
-    e = m_conns.end();
-    /*
-     * Compute a proper local port value
-     */
-    do {
-      lport = system::Clock::read() & 0xFFFF;
-    } while (lport < 4096);
-    /*
-     * Check if this port is already in use
-     */
-    for (auto it = m_conns.begin(); it != m_conns.end(); it++) {
-      if (it->m_state != Connection::CLOSED && it->m_lport == htons(lport)) {
-        e = it;
-      }
-    }
-  } while (e != m_conns.end());
-  /*
-   * Allocate a new connection
-   */
-  for (auto it = m_conns.begin(); it != m_conns.end(); it++) {
-    if (it->m_state == Connection::CLOSED) {
-      e = it;
-      break;
-    }
-    if (it->m_state == Connection::TIME_WAIT) {
-      if (e == m_conns.end() || it->m_timer > e->m_timer) {
-        e = it;
-      }
-    }
-  }
-  if (e == m_conns.end()) {
+  lport = acquirePort();
+  if (lport == 0) {
+    m_free.push_back(e->m_id);
     return Status::NoMoreResources;
   }
   /*
    * Add the filter to the device.
    */
-  ret = m_device.listen(lport);
+  Status ret = m_device.listen(lport);
   if (ret != Status::Ok) {
     TCP_LOG("registering client-side filter failed");
+    m_lports[lport >> 6] &= ~(1ULL << (lport & 0x3F));
+    m_free.push_back(e->m_id);
     return ret;
   }
   /*
@@ -120,18 +119,53 @@ Processor::connect(ethernet::Address const& rhwaddr,
   e->m_newdata = false;
   e->m_pshdata = false;
   e->m_wndscl = 0;
+  e->m_dupacks = 0;
+  e->m_recovery = false;
+  e->m_sackperm = false;
+  e->m_tsok = false;
   e->m_window = 0;
   e->m_segidx = 0;
+  e->m_segcnt = 0;
   e->m_nrtx = 1;
   e->m_slen = 0;
   e->m_sdat = nullptr;
   e->m_initialmss = m_device.mtu() - HEADER_OVERHEAD;
   e->m_mss = e->m_initialmss;
-  e->m_sa = 0;
-  e->m_sv = 16; // Initial value of the RTT variance
-  e->m_rto = RTO;
-  e->m_timer = RTO;
+  e->m_srtt = 0;
+  e->m_rttvar = 0;
+  e->m_recover = e->m_snd_nxt;
+  e->m_ecnce = false;
+  e->m_ackpend = false;
+  e->m_nprobe = 0;
+  e->m_tsrecent = 0;
+  e->m_tsage = 0;
+  e->m_kalast = 0;
+  e->m_kaidle = KEEPALIVE_IDLE;
+  e->m_kaintvl = KEEPALIVE_INTVL;
+  e->m_kacnt = KEEPALIVE_COUNT;
+  e->m_kaprobe = 0;
+  e->m_rcvbuf = m_rcvbuf;
+  e->m_rcvcon = e->m_rcv_nxt;
+  e->m_rcvadv = e->m_rcv_nxt;
+  e->m_rcvwsc = 0;
+  e->m_wscok = false;
+  e->m_rcvdefer = false;
+  e->m_cc.reset(e->m_initialmss, e->m_snd_nxt);
   e->m_cookie = nullptr;
+  /*
+   * Register the connection tuple.
+   */
+  m_index.insert(e->m_ripaddr, e->m_rport, e->m_lport, e->m_id);
+  /*
+   * Build the header template and allocate a send buffer.
+   */
+  setupTemplate(*e);
+  uint8_t* outdata;
+  ret = prepare(*e, outdata);
+  if (ret != Status::Ok) {
+    release(*e);
+    return ret;
+  }
   /*
    * Prepare the connection segment.
    */
@@ -141,15 +175,56 @@ Processor::connect(ethernet::Address const& rhwaddr,
    * Send SYN
    */
   OUTTCP->flags = 0;
-  if (sendSyn(*e, seg) != Status::Ok) {
-    m_device.unlisten(lport);
-    e->m_state = Connection::CLOSED;
+  ret = sendSyn(*e, seg);
+  if (ret != Status::Ok) {
+    release(*e);
     return ret;
   }
-  id = e - m_conns.begin();
+  id = e->m_id;
   return Status::Ok;
 }
 
+Port
+Processor::acquirePort()
+{
+  static constexpr uint32_t FIRST = 4096;
+  static constexpr uint32_t COUNT = 65536 - FIRST;
+  /*
+   * Start from a random port and look for the first clear bit in the port
+   * map, one 64-bit word at a time. Both bounds of the range are aligned on
+   * word boundaries, so wrapping around never splits a word.
+   */
+  const uint32_t start = system::Clock::read() % COUNT;
+  for (uint32_t n = 0; n < COUNT;) {
+    uint32_t port = FIRST + (start + n) % COUNT;
+    uint64_t word = ~m_lports[port >> 6] >> (port & 0x3F);
+    /*
+     * Skip the word if all the remaining ports are used.
+     */
+    if (word == 0) {
+      n += 64 - (port & 0x3F);
+      continue;
+    }
+    /*
+     * Skip to the first unused port.
+     */
+    const uint32_t skip = __builtin_ctzll(word);
+    port += skip;
+    n += skip + 1;
+    if (n > COUNT) {
+      break;
+    }
+    /*
+     * Do not hand out a port we are listening on.
+     */
+    if (m_listenports.count(htons(port)) == 0) {
+      m_lports[port >> 6] |= 1ULL << (port & 0x3F);
+      return port;
+    }
+  }
+  return 0;
+}
+
 Status
 Processor::abort(Connection::ID const& id)
 {
@@ -163,8 +238,7 @@ Processor::abort(Connection::ID const& id)
   /*
    * Abort the connection
    */
-  m_device.unlisten(c.m_lport);
-  c.m_state = Connection::CLOSED;
+  release(c);
   m_handler.onAborted(c);
   /*
    * Send the RST message.
@@ -230,7 +304,7 @@ Processor::send(Connection::ID const& id, const uint32_t len,
   if (c.m_state != Connection::ESTABLISHED) {
     return Status::NotConnected;
   }
-  if (HAS_NODELAY(c) && !c.hasAvailableSegments()) {
+  if (HAS_NODELAY(c) && !c.canSend()) {
     return Status::OperationInProgress;
   }
   if (len == 0 || data == nullptr) {
@@ -239,50 +313,222 @@ Processor::send(Connection::ID const& id, const uint32_t len,
   if (off >= len) {
     return Status::InvalidArgument;
   }
+  /*
+   * Transmit the data.
+   */
+  const struct iovec iov = { const_cast<uint8_t*>(data), len };
+  return sendv(c, &iov, 1, len, off);
+}
+
+Status
+Processor::sendv(Connection::ID const& id, const struct iovec* const iov,
+                 const size_t count, uint32_t& off)
+{
+  /*
+   * Check if the connection is valid.
+   */
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_conns[id];
+  if (c.m_state != Connection::ESTABLISHED) {
+    return Status::NotConnected;
+  }
+  if (HAS_NODELAY(c) && !c.canSend()) {
+    return Status::OperationInProgress;
+  }
+  if (count == 0 || iov == nullptr) {
+    return Status::InvalidArgument;
+  }
+  /*
+   * Compute the total length of the message.
+   */
+  uint64_t total = 0;
+  for (size_t i = 0; i < count; i += 1) {
+    if (iov[i].iov_len != 0 && iov[i].iov_base == nullptr) {
+      return Status::InvalidArgument;
+    }
+    total += iov[i].iov_len;
+  }
+  if (total == 0 || total > UINT32_MAX || off >= total) {
+    return Status::InvalidArgument;
+  }
+  /*
+   * Transmit the data.
+   */
+  return sendv(c, iov, count, uint32_t(total), off);
+}
+
+Status
+Processor::sendv(Connection& c, const struct iovec* const iov,
+                 const size_t count, const uint32_t len, uint32_t& off)
+{
   /*
    * Transmit the data. The off parameter is used to store how much data has
    * been written. It is also used as an offset in case the previous write was
    * partial. It is up to the application to reset that offset once the full
    * payload has been transfered.
    */
-  uint32_t bound = c.window() < m_mss ? c.window() : m_mss;
-  uint32_t slen = len - off;
+  uint32_t bound = sendBound(c);
   /*
    * Check the various corner cases: the remote window can suddenly become
    * smaller than what we want to send or it is just too small to send anything
    * of value.
    */
-  if (bound < c.m_slen) {
+  if (bound == 0 || bound < c.m_slen) {
     return Status::OperationInProgress;
   }
-  if (c.m_slen + slen > bound) {
-    slen = bound - c.m_slen;
-  }
   /*
-   * Copy the payload if there is any.
+   * With SEGMENTATION, slice the payload into as many segments as the
+   * connection can send, so that a payload larger than the MSS does not
+   * require one call per segment.
    */
-  if (slen != 0) {
-    memcpy(c.m_sdat + HEADER_LEN + c.m_slen, data + off, slen);
+  for (;;) {
+    uint32_t slen = len - off;
+    if (c.m_slen + slen > bound) {
+      slen = bound - c.m_slen;
+    }
     /*
-     * Remember how much data we send out now so that we know when everything
-     * has been acknowledged.
+     * Copy the payload if there is any, gathering it from the fragments that
+     * cover the range [off, off + slen).
      */
+    if (slen != 0) {
+      gather(c.m_sdat + c.headerLength() + c.m_slen, iov, count, off, slen);
+      /*
+       * Remember how much data we send out now so that we know when
+       * everything has been acknowledged.
+       */
+      off += slen;
+      c.m_slen = c.m_slen + slen;
+    }
+    /*
+     * Check if we can send the current segment.
+     */
+    if (!c.canSend()) {
+      return slen == 0 ? Status::OperationInProgress : Status::Ok;
+    }
+    /*
+     * Send the segment.
+     */
+    Status res = HAS_NODELAY(c) ? sendNoDelay(c, off == len ? TCP_PSH : 0)
+                                : sendNagle(c, bound);
+    /*
+     * Stop if the payload is consumed, if the segment has been held back, or
+     * if the next segment would not fit in the remote window.
+     */
+    if (!HAS_SEGMENTATION(c) || res != Status::Ok || off == len ||
+        c.hasPendingSendData() || c.inflight() + bound > c.window()) {
+      return res;
+    }
+  }
+}
+
+Status
+Processor::sendZeroCopy(Connection::ID const& id, const uint32_t len,
+                        const uint8_t* const data, uint32_t& off)
+{
+  /*
+   * Check if the connection is valid.
+   */
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_conns[id];
+  if (c.m_state != Connection::ESTABLISHED) {
+    return Status::NotConnected;
+  }
+  if (!c.canSend()) {
+    return Status::OperationInProgress;
+  }
+  if (len == 0 || data == nullptr) {
+    return Status::InvalidArgument;
+  }
+  if (off >= len) {
+    return Status::InvalidArgument;
+  }
+  /*
+   * Send the data buffered by send() first, to preserve the ordering.
+   */
+  if (c.hasPendingSendData()) {
+    Status res = sendNoDelay(c);
+    if (res != Status::Ok) {
+      return res;
+    }
+    if (!c.canSend()) {
+      return Status::OperationInProgress;
+    }
+  }
+  uint32_t bound = sendBound(c);
+  if (bound == 0) {
+    return Status::OperationInProgress;
+  }
+  /*
+   * Send segments that reference the data. With SEGMENTATION, send as many of
+   * them as the connection can send.
+   */
+  for (;;) {
+    uint32_t slen = len - off < bound ? len - off : bound;
+    Segment& seg = c.nextAvailableSegment();
+    seg.set(slen, c.m_snd_nxt, c.m_sdat, c.headerLength());
+    reference(seg, data + off);
+    c.resetSendBuffer();
     off += slen;
-    c.m_slen = c.m_slen + slen;
+    Status res = send(c, seg, off == len ? TCP_PSH : 0);
+    /*
+     * Stop if the payload is consumed, or if the next segment cannot be sent.
+     */
+    if (!HAS_SEGMENTATION(c) || res != Status::Ok || off == len ||
+        !c.canSend() || c.inflight() + bound > c.window()) {
+      return res;
+    }
   }
+}
+
+Status
+Processor::setReceiveBuffer(Connection::ID const& id, const uint32_t len)
+{
   /*
-   * Check if we can send the current segment.
+   * Check if the connection is valid.
    */
-  if (!c.hasAvailableSegments()) {
-    return slen == 0 ? Status::OperationInProgress : Status::Ok;
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_conns[id];
+  if (c.m_state != Connection::ESTABLISHED) {
+    return Status::NotConnected;
+  }
+  c.setReceiveBuffer(len);
+  return Status::Ok;
+}
+
+Status
+Processor::consume(Connection::ID const& id, const uint32_t len)
+{
+  /*
+   * Check if the connection is valid.
+   */
+  if (id >= m_nconn) {
+    return Status::InvalidConnection;
+  }
+  Connection& c = m_conns[id];
+  if (c.m_state != Connection::ESTABLISHED) {
+    return Status::NotConnected;
+  }
+  if (!c.m_rcvdefer) {
+    return Status::InvalidArgument;
   }
   /*
-   * Send the segment.
+   * The application cannot consume more than what it has received.
    */
-  if (HAS_NODELAY(c)) {
-    return sendNoDelay(c, off == len ? TCP_PSH : 0);
+  uint32_t used = c.m_rcv_nxt - c.m_rcvcon;
+  c.m_rcvcon += len > used ? used : len;
+  /*
+   * Let the peer know if the window opened enough.
+   */
+  if (c.canOpenWindow(c.receiveSpace())) {
+    return sendAck(c);
   }
-  return sendNagle(c, bound);
+  return Status::Ok;
 }
 
 Status
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Congestion.h>
+#include <cmath>
+#include <cstdint>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+constexpr uint64_t Congestion::CUBIC_C;
+constexpr uint64_t Congestion::CUBIC_BETA;
+constexpr uint64_t Congestion::CUBIC_ALPHA;
+constexpr uint32_t Congestion::DCTCP_ALPHA_MAX;
+constexpr uint32_t Congestion::DCTCP_G_SHIFT;
+
+Congestion::Congestion()
+  : m_epoch(0)
+  , m_cwnd(0)
+  , m_ssthresh(UINT32_MAX)
+  , m_acked(0)
+  , m_wmax(0)
+  , m_origin(0)
+  , m_k(0)
+  , m_west(0)
+  , m_alpha(DCTCP_ALPHA_MAX)
+  , m_ackbytes(0)
+  , m_cebytes(0)
+  , m_wndend(0)
+  , m_cwr(false)
+{}
+
+void
+Congestion::reset(const uint16_t mss, const uint32_t snd_nxt)
+{
+  /*
+   * Initial window, as per RFC 6928: min(10 * MSS, max(2 * MSS, 14600)).
+   */
+  uint32_t iw = 2 * mss > 14600 ? 2 * mss : 14600;
+  m_cwnd = 10 * mss < iw ? 10 * mss : iw;
+  m_ssthresh = UINT32_MAX;
+  m_acked = 0;
+  m_epoch = 0;
+  m_wmax = 0;
+  m_origin = 0;
+  m_k = 0;
+  m_west = 0;
+  m_alpha = DCTCP_ALPHA_MAX;
+  m_ackbytes = 0;
+  m_cebytes = 0;
+  m_wndend = snd_nxt;
+  m_cwr = false;
+}
+
+void
+Congestion::onAck(const Algorithm algo, const uint16_t mss,
+                  const uint32_t acked, const system::Clock::Value rtt,
+                  const system::Clock::Value now)
+{
+  if (algo == NONE) {
+    return;
+  }
+  /*
+   * Slow start, increase the window by the acknowledged bytes, at most 2 MSS
+   * per ACK (RFC 3465).
+   */
+  if (m_cwnd < m_ssthresh) {
+    m_cwnd += acked < 2U * mss ? acked : 2U * mss;
+    return;
+  }
+  /*
+   * Congestion avoidance.
+   */
+  switch (algo) {
+    case CUBIC: {
+      increaseCubic(mss, acked, rtt, now);
+      break;
+    }
+    case NONE:
+    case NEWRENO:
+    case DCTCP:
+    default: {
+      /*
+       * Increase the window by one MSS per window of acknowledged bytes.
+       */
+      m_acked += acked;
+      if (m_acked >= m_cwnd) {
+        m_acked -= m_cwnd;
+        m_cwnd += mss;
+      }
+      break;
+    }
+  }
+}
+
+void
+Congestion::onEcn(const uint16_t mss, const uint32_t acked, const bool ece,
+                  const uint32_t ackno, const uint32_t snd_nxt)
+{
+  m_ackbytes += acked;
+  m_cebytes += ece ? acked : 0;
+  /*
+   * Reduce the window at most once per window of data, by a factor
+   * proportional to the extent of the congestion.
+   */
+  if (ece && !m_cwr) {
+    m_cwnd -= ((uint64_t)m_cwnd * m_alpha) >> 11;
+    m_cwnd = m_cwnd < 2U * mss ? 2U * mss : m_cwnd;
+    m_ssthresh = m_cwnd;
+    m_acked = 0;
+    m_cwr = true;
+  }
+  /*
+   * At the end of the observation window, update the estimation of the
+   * fraction of marked bytes: alpha = (1 - g) * alpha + g * F.
+   */
+  if ((int32_t)(ackno - m_wndend) >= 0) {
+    uint32_t frac = 0;
+    if (m_ackbytes != 0) {
+      frac = ((uint64_t)m_cebytes << 10) / m_ackbytes;
+    }
+    m_alpha = m_alpha - (m_alpha >> DCTCP_G_SHIFT) + (frac >> DCTCP_G_SHIFT);
+    m_ackbytes = 0;
+    m_cebytes = 0;
+    m_wndend = snd_nxt;
+    m_cwr = false;
+  }
+}
+
+void
+Congestion::onLoss(const Algorithm algo, const uint16_t mss,
+                   const uint32_t flight)
+{
+  if (algo == NONE) {
+    return;
+  }
+  reduce(algo, mss, flight);
+  m_cwnd = m_ssthresh;
+}
+
+void
+Congestion::onTimeout(const Algorithm algo, const uint16_t mss,
+                      const uint32_t flight)
+{
+  if (algo == NONE) {
+    return;
+  }
+  reduce(algo, mss, flight);
+  m_cwnd = mss;
+}
+
+void
+Congestion::reduce(const Algorithm algo, const uint16_t mss,
+                   const uint32_t flight)
+{
+  switch (algo) {
+    /*
+     * CUBIC, remember the window before the reduction and start a new epoch.
+     * With fast convergence, release some bandwidth to the new flows if the
+     * window did not recover since the previous reduction.
+     */
+    case CUBIC: {
+      if (m_cwnd < m_wmax) {
+        m_wmax = ((uint64_t)m_cwnd * (1024 + CUBIC_BETA)) >> 11;
+      } else {
+        m_wmax = m_cwnd;
+      }
+      m_ssthresh = ((uint64_t)m_cwnd * CUBIC_BETA) >> 10;
+      m_epoch = 0;
+      break;
+    }
+    /*
+     * NewReno and DCTCP, half the data in flight (RFC 5681).
+     */
+    case NONE:
+    case NEWRENO:
+    case DCTCP:
+    default: {
+      m_ssthresh = flight >> 1;
+      break;
+    }
+  }
+  m_ssthresh = m_ssthresh < 2U * mss ? 2U * mss : m_ssthresh;
+  m_acked = 0;
+}
+
+void
+Congestion::increaseCubic(const uint16_t mss, const uint32_t acked,
+                          const system::Clock::Value rtt,
+                          const system::Clock::Value now)
+{
+  /*
+   * Start a new epoch. K is the time, in units of 2^-10 seconds, that the
+   * cubic function takes to increase the window back to Wmax.
+   */
+  if (m_epoch == 0) {
+    m_epoch = now;
+    m_west = m_cwnd;
+    if (m_cwnd < m_wmax) {
+      double seg = (double)(m_wmax - m_cwnd) / mss;
+      m_k = (uint32_t)(std::cbrt(seg * 1024 / CUBIC_C) * 1024);
+      m_origin = m_wmax;
+    } else {
+      m_k = 0;
+      m_origin = m_cwnd;
+    }
+  }
+  /*
+   * Compute the target window one RTT ahead: W(t) = C * (t - K)^3 + Wmax.
+   */
+  uint64_t cps = CLOCK_SECOND >> 10;
+  uint64_t t = (now - m_epoch + rtt) / (cps == 0 ? 1 : cps);
+  uint64_t offs = t > m_k ? t - m_k : m_k - t;
+  offs = offs > (1ULL << 20) ? 1ULL << 20 : offs;
+  uint64_t delta = ((((offs * offs * offs) >> 10) * CUBIC_C) >> 30) * mss;
+  uint64_t target;
+  if (t > m_k) {
+    target = m_origin + delta;
+  } else {
+    target = m_origin > delta ? m_origin - delta : 0;
+  }
+  /*
+   * The target is bounded to [cwnd, 1.5 * cwnd].
+   */
+  uint64_t high = (uint64_t)m_cwnd + (m_cwnd >> 1);
+  target = target < m_cwnd ? m_cwnd : target > high ? high : target;
+  /*
+   * Reno-friendly region, the window grows at least as fast as an AIMD flow
+   * with the same average throughput.
+   */
+  m_west += (CUBIC_ALPHA * acked * mss / m_cwnd) >> 10;
+  target = target < m_west ? m_west : target;
+  /*
+   * Grow the window by (target - cwnd) / cwnd per acknowledged byte.
+   */
+  m_cwnd += (target - m_cwnd) * acked / m_cwnd;
+}
+
+}}}
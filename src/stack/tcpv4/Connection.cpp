@@ -42,20 +42,44 @@ Connection::Connection()
   , m_newdata(false)
   , m_pshdata(false)
   , m_wndscl(0)
+  , m_dupacks(0)
+  , m_recovery(false)
+  , m_sackperm(false)
+  , m_tsok(false)
   , m_window(0)
   , m_segidx(0)
-  , m_nrtx(0)
   , m_slen(0)
   , m_sdat(nullptr)
+  , m_segments(nullptr)
   , m_initialmss(0)
   , m_mss(0)
-  , m_sa(0)
-  , m_sv(0)
-  , m_rto(0)
-  , m_timer(0)
   , m_opts(0)
+  , m_segcnt(0)
   , m_cookie(nullptr)
-  , m_segments()
+  , m_srtt(0)
+  , m_rttvar(0)
+  , m_cc()
+  , m_recover(0)
+  , m_ecnce(false)
+  , m_ackpend(false)
+  , m_ackq(false)
+  , m_nprobe(0)
+  , m_nrtx(0)
+  , m_tsrecent(0)
+  , m_tsage(0)
+  , m_kalast(0)
+  , m_kaidle(0)
+  , m_kaintvl(0)
+  , m_kacnt(0)
+  , m_kaprobe(0)
+  , m_rcvbuf(0)
+  , m_rcvcon(0)
+  , m_rcvadv(0)
+  , m_rcvwsc(0)
+  , m_wscok(false)
+  , m_rcvdefer(false)
+  , m_hdr()
+  , m_hdrsum(0)
 {}
 
 }}}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Index.h>
+#include <tulips/system/Utils.h>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Size the table for a load factor of at most 1/2.
+ */
+static size_t
+bitsFor(const size_t nconn)
+{
+  size_t bits = 1;
+  while ((1ULL << bits) < (nconn << 1)) {
+    bits += 1;
+  }
+  return bits;
+}
+
+constexpr Connection::ID Index::NONE;
+
+Index::Index(const size_t nconn)
+  : m_shift(64 - bitsFor(nconn))
+  , m_mask((1ULL << bitsFor(nconn)) - 1)
+  , m_table(m_mask + 1, Entry{ 0, NONE })
+{}
+
+void
+Index::insert(ipv4::Address const& ripaddr, const Port rport, const Port lport,
+              const Connection::ID id)
+{
+  const Key key = keyOf(ripaddr, rport, lport);
+  /*
+   * Look for the first free entry, or for the entry of the same key.
+   */
+  size_t i = slotOf(key);
+  while (m_table[i].m_id != NONE && m_table[i].m_key != key) {
+    i = (i + 1) & m_mask;
+  }
+  m_table[i].m_key = key;
+  m_table[i].m_id = id;
+}
+
+void
+Index::erase(ipv4::Address const& ripaddr, const Port rport, const Port lport)
+{
+  const Key key = keyOf(ripaddr, rport, lport);
+  /*
+   * Look for the entry. If it is not there, there is nothing to do.
+   */
+  size_t i = slotOf(key);
+  while (m_table[i].m_id != NONE && m_table[i].m_key != key) {
+    i = (i + 1) & m_mask;
+  }
+  if (m_table[i].m_id == NONE) {
+    return;
+  }
+  /*
+   * Shift back the entries that follow in the cluster if their home slot lies
+   * cyclically outside of (i, j]. This keeps every entry reachable from its
+   * home slot without leaving tombstones behind.
+   */
+  for (size_t j = (i + 1) & m_mask; m_table[j].m_id != NONE;
+       j = (j + 1) & m_mask) {
+    const size_t k = slotOf(m_table[j].m_key);
+    const bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+    if (!stays) {
+      m_table[i] = m_table[j];
+      i = j;
+    }
+  }
+  m_table[i].m_id = NONE;
+}
+
+}}}
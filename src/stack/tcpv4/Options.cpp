@@ -91,6 +91,25 @@ parse(Connection& e, const uint16_t len, const uint8_t* const data)
        */
       e.m_wndscl = wsc > 14 ? 14 : wsc;
       e.m_window >>= e.m_wndscl;
+      e.m_wscok = true;
+    }
+    /*
+     * A SAP option with the right option length.
+     */
+    else if (opt == SAP && options[c + 1] == SAP_LEN) {
+      c += SAP_LEN;
+      OPT_LOG("SACK permitted");
+      e.m_sackperm = true;
+    }
+    /*
+     * A TSO option with the right option length.
+     */
+    else if (opt == TSO && options[c + 1] == TSO_LEN) {
+      uint32_t tsval = ntohl(*(uint32_t*)&options[c + 2]);
+      c += TSO_LEN;
+      OPT_LOG("timestamps permitted");
+      e.m_tsok = true;
+      e.m_tsrecent = tsval;
     }
     /*
      * All other options have a length field, so that we easily can
@@ -122,4 +141,109 @@ parse(Connection& e, const uint16_t len, const uint8_t* const data)
   }
 }
 
+bool
+parseTimestamps(const uint16_t len, const uint8_t* const data, uint32_t& tsval,
+                uint32_t& tsecr)
+{
+  const uint8_t* options = &data[HEADER_LEN];
+  /*
+   * Fast path, for the layout recommended by RFC 7323 (Appendix A).
+   */
+  if (len >= TSO_PAD && options[0] == NOOP && options[1] == NOOP &&
+      options[2] == TSO && options[3] == TSO_LEN) {
+    tsval = ntohl(*(uint32_t*)&options[4]);
+    tsecr = ntohl(*(uint32_t*)&options[8]);
+    return true;
+  }
+  /*
+   * Look for the TSO option.
+   */
+  for (int c = 0; c < len;) {
+    uint8_t opt = options[c];
+    /*
+     * End of options.
+     */
+    if (opt == END) {
+      break;
+    }
+    /*
+     * NOP option.
+     */
+    else if (opt == NOOP) {
+      c += 1;
+    }
+    /*
+     * A TSO option with the right option length.
+     */
+    else if (opt == TSO) {
+      if (options[c + 1] != TSO_LEN || c + TSO_LEN > len) {
+        break;
+      }
+      tsval = ntohl(*(uint32_t*)&options[c + 2]);
+      tsecr = ntohl(*(uint32_t*)&options[c + 6]);
+      return true;
+    }
+    /*
+     * All other options have a length field, so that we easily can skip past
+     * them.
+     */
+    else {
+      if (options[c + 1] == 0) {
+        break;
+      }
+      c += options[c + 1];
+    }
+  }
+  return false;
+}
+
+void
+parseSack(Connection& e, const uint16_t len, const uint8_t* const data)
+{
+  const uint8_t* options = &data[HEADER_LEN];
+  /*
+   * Look for the SACK option.
+   */
+  for (int c = 0; c < len;) {
+    uint8_t opt = options[c];
+    /*
+     * End of options.
+     */
+    if (opt == END) {
+      break;
+    }
+    /*
+     * NOP option.
+     */
+    else if (opt == NOOP) {
+      c += 1;
+    }
+    /*
+     * A SACK option, with at most 4 blocks.
+     */
+    else if (opt == SACK) {
+      uint8_t olen = options[c + 1];
+      if (olen < 2 + SACK_BLK || c + olen > len) {
+        break;
+      }
+      for (int b = c + 2; b + SACK_BLK <= c + olen; b += SACK_BLK) {
+        uint32_t left = ntohl(*(uint32_t*)&options[b]);
+        uint32_t right = ntohl(*(uint32_t*)&options[b + 4]);
+        e.markSacked(left, right);
+      }
+      break;
+    }
+    /*
+     * All other options have a length field, so that we easily can skip past
+     * them.
+     */
+    else {
+      if (options[c + 1] == 0) {
+        break;
+      }
+      c += options[c + 1];
+    }
+  }
+}
+
 }}}}
@@ -52,18 +52,46 @@ Processor::Processor(transport::Device& device, ethernet::Producer& eth,
   , m_ipv4from(nullptr)
   , m_iss(0)
   , m_mss(m_ipv4to.mss() - HEADER_LEN)
+  , m_timestamps(false)
+  , m_syncookies(false)
+  , m_syncookie()
+  , m_rcvbuf(0)
+  , m_rcvwsc(0)
   , m_listenports()
+  , m_lports(1 << 10, 0)
   , m_conns()
+  , m_segments(nconn * Connection::SEGMENT_COUNT)
+  , m_zcrefs(nconn * Connection::SEGMENT_COUNT, nullptr)
+  , m_free()
+  , m_delacks()
+  , m_delackts(0)
+  , m_burst(false)
+  , m_grocid(Index::NONE)
+  , m_grofrags()
+  , m_halfopen(nconn)
+  , m_timewait(nconn)
+  , m_index(nconn)
+  , m_timers(nconn)
+  , m_ooo(nconn, OOO_POOL, OOO_DEPTH, m_device.mtu() - HEADER_OVERHEAD)
   , m_stats()
   , m_timer()
+  , m_minrto(CLOCK_SECOND / 5)
+  , m_maxrto(120 * CLOCK_SECOND)
 {
   m_timer.set(CLOCK_SECOND);
+  setReceiveWindow(RCVBUF);
   m_conns.resize(nconn);
+  m_free.reserve(nconn);
+  m_delacks.reserve(nconn);
+  m_grofrags.reserve(GRO_DEPTH);
   /*
-   * Set the connection IDs and create the buffers.
+   * Set the connection IDs and their segments. The free list is a stack, fill
+   * it so that the lowest IDs are used first.
    */
   for (uint16_t id = 0; id < nconn; id += 1) {
     m_conns[id].m_id = id;
+    m_conns[id].m_segments = &m_segments[id * Connection::SEGMENT_COUNT];
+    m_free.push_back(nconn - id - 1);
   }
 }
 
@@ -85,85 +113,291 @@ Processor::unlisten(const Port port)
 Status
 Processor::run()
 {
+  const system::Clock::Value now = system::Clock::read();
+  Status res = Status::Ok;
+  Connection::ID id;
+  Timers::Kind kind;
   /*
-   * Check if the TCP timer has expired. This timer facility is not exact and
-   * only guarantees that at least the period amount has been exhausted.
+   * Increase the initial sequence number every second.
    */
-  if (!m_timer.expired()) {
-    return Status::Ok;
+  if (m_timer.expired()) {
+    m_timer.reset();
+    m_iss += 1;
   }
   /*
-   * Reset the timer, increase the initial sequence number.
+   * Send the ACKs delayed during the last burst of incoming segments.
    */
-  m_timer.reset();
-  m_iss += 1;
+  res = flush();
   /*
-   * Scan the connections
+   * Process all the timers that have expired.
    */
-  for (auto& e : m_conns) {
-    /*
-     * Ignore closed connections
-     */
-    if (e.m_state == Connection::CLOSED) {
-      continue;
-    }
-    /*
-     * Check if the connection is in a state in which we simply wait for the
-     * connection to time out.
-     */
-    if (e.m_state == Connection::TIME_WAIT ||
-        e.m_state == Connection::FIN_WAIT_2) {
+  while (m_timers.expired(now, id, kind)) {
+    Connection& e = m_conns[id];
+    Status ret = Status::Ok;
+    switch (kind) {
       /*
-       * Increase the connection's timer.
+       * The connection is done waiting in FIN_WAIT_2 or TIME_WAIT, close it.
        */
-      e.m_timer += 1;
+      case Timers::WAIT: {
+        if (e.m_state == Connection::TIME_WAIT ||
+            e.m_state == Connection::FIN_WAIT_2) {
+          TCP_LOG("connection closed");
+          release(e);
+        }
+        break;
+      }
       /*
-       * If it timed out, close the connection.
+       * The retransmission timer has expired.
        */
-      if (e.m_timer == TIME_WAIT_TIMEOUT) {
-        TCP_LOG("connection closed");
-        m_device.unlisten(e.m_lport);
-        e.m_state = Connection::CLOSED;
-        continue;
+      case Timers::REXMIT: {
+        ret = onRexmitTimeout(e, now);
+        break;
+      }
+      /*
+       * The persist timer has expired.
+       */
+      case Timers::PERSIST: {
+        ret = onPersistTimeout(e, now);
+        break;
+      }
+      /*
+       * The keep-alive timer has expired.
+       */
+      case Timers::KEEPALIVE: {
+        ret = onKeepAliveTimeout(e, now);
+        break;
+      }
+      default: {
+        break;
       }
     }
     /*
-     * If the connection does not have any outstanding data, skip it.
+     * Keep going, but remember the first error.
      */
-    if (!e.hasOutstandingSegments()) {
+    if (ret != Status::Ok && res == Status::Ok) {
+      res = ret;
+    }
+  }
+  return res;
+}
+
+Status
+Processor::onRexmitTimeout(Connection& e, const system::Clock::Value now)
+{
+  /*
+   * If the connection does not have any outstanding data, skip it.
+   */
+  if (e.m_state == Connection::CLOSED || !e.hasOutstandingSegments()) {
+    return Status::Ok;
+  }
+  /*
+   * Retransmission timeout, reset the connection.
+   */
+  if (e.m_nrtx == MAXRTX || ((e.m_state == Connection::SYN_SENT ||
+                              e.m_state == Connection::SYN_RCVD) &&
+                             e.m_nrtx == MAXSYNRTX)) {
+    TCP_LOG("aborting the connection");
+    m_handler.onTimedOut(e);
+    return sendAbort(e);
+  }
+  /*
+   * Exponential backoff, bounded by the maximum RTO.
+   */
+  system::Clock::Value period = rto(e) << (e.m_nrtx > 4 ? 4 : e.m_nrtx);
+  period = period > m_maxrto ? m_maxrto : period;
+  e.m_nrtx += 1;
+  m_timers.arm(e.m_id, Timers::REXMIT, now + period);
+  /*
+   * Collapse the congestion window and enter loss recovery. The segments sent
+   * before the time-out are retransmitted as partial ACKs come in (RFC 6582).
+   */
+  if (e.m_state == Connection::ESTABLISHED) {
+    e.m_cc.onTimeout(e.algorithm(), e.m_initialmss, e.inflight());
+  }
+  e.startRecovery(true);
+  e.segment().m_rexmit = true;
+  /*
+   * Ok, so we need to retransmit.
+   */
+  TCP_LOG("automatic repeat request (" << e.m_nrtx << "/" << MAXRTX << ")");
+  TCP_LOG("segments available? " << std::boolalpha
+                                 << e.hasAvailableSegments());
+  TCP_LOG("segments outstanding? " << std::boolalpha
+                                   << e.hasOutstandingSegments());
+  return rexmit(e);
+}
+
+Status
+Processor::onPersistTimeout(Connection& e, const system::Clock::Value now)
+{
+  /*
+   * If the window has been re-opened, or if there is outstanding data whose
+   * retransmissions probe the window, skip it.
+   */
+  if (e.m_state != Connection::ESTABLISHED || e.m_window != 0 ||
+      e.hasOutstandingSegments()) {
+    return Status::Ok;
+  }
+  /*
+   * Keep probing as long as the peer acknowledges the probes (RFC 1122), with
+   * an exponential backoff.
+   */
+  m_stats.probe += 1;
+  e.m_nprobe += e.m_nprobe < MAXPROBESHIFT ? 1 : 0;
+  setPersistTimer(e, now);
+  return sendProbe(e);
+}
+
+Status
+Processor::onKeepAliveTimeout(Connection& e, const system::Clock::Value now)
+{
+  /*
+   * Skip the connection if it is not established or if the option was cleared.
+   */
+  if (e.m_state != Connection::ESTABLISHED || !HAS_KEEPALIVE(e)) {
+    return Status::Ok;
+  }
+  /*
+   * If the connection has outstanding data, its retransmissions take care of
+   * an unresponsive peer. Otherwise, if a segment was received since the timer
+   * was armed, re-arm it from that point.
+   */
+  system::Clock::Value idle = e.m_kaidle * CLOCK_SECOND;
+  if (e.hasOutstandingSegments()) {
+    m_timers.arm(e.m_id, Timers::KEEPALIVE, now + idle);
+    return Status::Ok;
+  }
+  if ((int64_t)(now - e.m_kalast) < (int64_t)idle) {
+    m_timers.arm(e.m_id, Timers::KEEPALIVE, e.m_kalast + idle);
+    return Status::Ok;
+  }
+  /*
+   * The peer did not answer any of the probes, reset the connection.
+   */
+  if (e.m_kaprobe >= e.m_kacnt) {
+    TCP_LOG("keep-alive timeout, aborting the connection");
+    m_stats.kadrop += 1;
+    m_handler.onTimedOut(e);
+    return sendAbort(e);
+  }
+  /*
+   * Send a probe, as per RFC 1122 (4.2.3.6).
+   */
+  e.m_kaprobe += 1;
+  m_timers.arm(e.m_id, Timers::KEEPALIVE, now + e.m_kaintvl * CLOCK_SECOND);
+  return sendProbe(e);
+}
+
+Status
+Processor::flush()
+{
+  /*
+   * Deliver the segments held back during the burst.
+   */
+  Status res = m_grocid != Index::NONE ? deliver() : Status::Ok;
+  m_burst = false;
+  /*
+   * Send an ACK on the connections that have not acknowledged their received
+   * data yet, either with a segment of their own or with outbound data.
+   */
+  for (auto id : m_delacks) {
+    Connection& e = m_conns[id];
+    e.m_ackq = false;
+    if (!e.m_ackpend) {
       continue;
     }
+    m_stats.delack += 1;
+    Status ret = sendAck(e);
     /*
-     * Check if the connection needs a retransmission.
+     * Keep going, but remember the first error.
      */
-    e.m_timer -= 1;
-    if (e.m_timer > 0) {
-      continue;
+    if (ret != Status::Ok && res == Status::Ok) {
+      res = ret;
     }
+  }
+  m_delacks.clear();
+  return res;
+}
+
+bool
+Processor::isCoalescable(Connection const& e, const uint16_t len,
+                         const uint8_t* const data) const
+{
+  return e.m_state == Connection::ESTABLISHED &&
+         (INTCP->flags & (TCP_CTL & ~TCP_PSH)) == TCP_ACK &&
+         len > HEADER_LEN_WITH_OPTS(INTCP) &&
+         ntohl(INTCP->seqno) == e.m_rcv_nxt;
+}
+
+Status
+Processor::deliver()
+{
+  Connection& e = m_conns[m_grocid];
+  const size_t count = m_grofrags.size();
+  m_grocid = Index::NONE;
+  /*
+   * Drop the fragments if the connection is gone.
+   */
+  if (e.m_state != Connection::ESTABLISHED) {
+    m_grofrags.clear();
+    return Status::Ok;
+  }
+  m_stats.gro += count;
+  /*
+   * Send an ACK right away if the connection does not support DELAYED_ACK.
+   */
+  if (!HAS_DELAYED_ACK(e)) {
+    Status res = sendAck(e);
+    if (res != Status::Ok) {
+      m_grofrags.clear();
+      return res;
+    }
+  }
+  /*
+   * Notify the application, and allow it to send a response if possible.
+   */
+  bool can_send = e.canSend() && e.window() > e.m_slen;
+  Action act;
+  if (likely(can_send)) {
+    uint32_t rlen = 0;
+    uint32_t bound = sendBound(e);
+    uint32_t alen = bound - e.m_slen;
+    act = m_handler.onNewData(e, m_grofrags.data(), count, alen,
+                              e.m_sdat + e.headerLength() + e.m_slen, rlen);
     /*
-     * Retransmission timeout, reset the connection.
+     * Truncate to available length if necessary
      */
-    if (e.m_nrtx == MAXRTX || ((e.m_state == Connection::SYN_SENT ||
-                                e.m_state == Connection::SYN_RCVD) &&
-                               e.m_nrtx == MAXSYNRTX)) {
-      TCP_LOG("aborting the connection");
-      m_handler.onTimedOut(e);
+    if (rlen > alen) {
+      rlen = alen;
+    }
+    e.m_slen += rlen;
+  } else {
+    act = m_handler.onNewData(e, m_grofrags.data(), count);
+  }
+  m_grofrags.clear();
+  switch (act) {
+    case Action::Abort:
       return sendAbort(e);
+    case Action::Close:
+      return sendClose(e);
+    default:
+      break;
+  }
+  /*
+   * If there is any buffered send data, send it. It carries the cumulative ACK.
+   */
+  if (e.hasPendingSendData() && can_send) {
+    return sendNoDelay(e, TCP_PSH);
+  }
+  /*
+   * Otherwise, send one cumulative ACK for the coalesced segments. A single
+   * segment follows the usual DELAYED_ACK rules.
+   */
+  if (HAS_DELAYED_ACK(e)) {
+    if (e.m_ackpend || count > 1) {
+      return sendAck(e);
     }
-    /*
-     * Exponential backoff.
-     */
-    e.m_timer = RTO << (e.m_nrtx > 4 ? 4 : e.m_nrtx);
-    e.m_nrtx += 1;
-    /*
-     * Ok, so we need to retransmit.
-     */
-    TCP_LOG("automatic repeat request (" << e.m_nrtx << "/" << MAXRTX << ")");
-    TCP_LOG("segments available? " << std::boolalpha
-                                   << e.hasAvailableSegments());
-    TCP_LOG("segments outstanding? " << std::boolalpha
-                                     << e.hasOutstandingSegments());
-    return rexmit(e);
+    delayAck(e);
   }
   return Status::Ok;
 }
@@ -171,14 +405,35 @@ Processor::run()
 Status
 Processor::process(const uint16_t len, const uint8_t* const data)
 {
-  Connections::iterator e;
+  Status res = demux(len, data);
+  /*
+   * Outside of a burst, nothing else flushes the delayed ACKs until the
+   * processor runs. Send them if the oldest one has been held back too long.
+   */
+  if (m_burst || m_delacks.empty()) {
+    return res;
+  }
+  const system::Clock::Value now = system::Clock::read();
+  if (now - m_delackts < DELACK_TIMEOUT * CLOCK_SECOND / 1000) {
+    return res;
+  }
+  Status ret = flush();
+  return res != Status::Ok ? res : ret;
+}
+
+Status
+Processor::demux(const uint16_t len, const uint8_t* const data)
+{
+  Connection* e;
+  Connection::ID id;
   m_stats.recv += 1;
   /*
    * Compute and check the TCP checksum.
    */
 #ifndef TULIPS_DISABLE_CHECKSUM_CHECK
-  uint16_t csum = checksum(m_ipv4from->sourceAddress(),
-                           m_ipv4from->destinationAddress(), len, data);
+  uint16_t seed = pseudoHeader(m_ipv4from->sourceAddress(),
+                               m_ipv4from->destinationAddress());
+  uint16_t csum = checksum(seed, len, data);
   if (csum != 0xffff) {
     m_stats.drop += 1;
     m_stats.chkerr += 1;
@@ -192,15 +447,10 @@ Processor::process(const uint16_t len, const uint8_t* const data)
   /*
    * Demultiplex this segment. First check any active connections.
    */
-  for (auto& e : m_conns) {
-    /*
-     * If it matches, process it.
-     */
-    if (e.m_state != Connection::CLOSED && INTCP->destport == e.m_lport &&
-        INTCP->srcport == e.m_rport &&
-        m_ipv4from->sourceAddress() == e.m_ripaddr) {
-      return process(e, len, data);
-    }
+  id = m_index.find(m_ipv4from->sourceAddress(), INTCP->srcport,
+                    INTCP->destport);
+  if (id != Index::NONE) {
+    return process(m_conns[id], len, data);
   }
   /*
    * If we didn't find and active connection that expected the packet, either
@@ -209,6 +459,15 @@ Processor::process(const uint16_t len, const uint8_t* const data)
    * send a RST.
    */
   if ((INTCP->flags & TCP_CTL) != TCP_SYN) {
+    /*
+     * With SYN cookies, the ACK that completes a handshake does not have a
+     * connection yet.
+     */
+    if (m_syncookies &&
+        (INTCP->flags & (TCP_SYN | TCP_RST | TCP_ACK)) == TCP_ACK &&
+        m_listenports.count(INTCP->destport) != 0) {
+      return acceptCookie(len, data);
+    }
     TCP_LOG("no connection waiting for a SYN/ACK");
     return reset(len, data);
   }
@@ -221,52 +480,56 @@ Processor::process(const uint16_t len, const uint8_t* const data)
     return reset(len, data);
   }
   /*
-   * Handle the new connection. First we check if there are any connections
-   * available. Unused connections are kept in the same table as used
-   * connections, but unused ones have the tcpstate set to CLOSED. Also,
-   * connections in TIME_WAIT are kept track of and we'll use the oldest one if
-   * no CLOSED connections are found. Thanks to Eddie C. Dost for a very nice
-   * algorithm for the TIME_WAIT search.
+   * Answer with a SYN cookie if enabled and no connection is available.
    */
-  for (e = m_conns.begin(); e != m_conns.end(); e++) {
-    if (e->m_state == Connection::CLOSED) {
-      break;
-    }
+  if (m_syncookies && m_free.empty() && m_timewait.empty()) {
+    return sendCookie(data);
   }
   /*
-   * If no connection is available, take the oldest waiting connection
+   * Handle the new connection.
    */
-  if (e == m_conns.end()) {
-    for (auto c = m_conns.begin(); c != m_conns.end(); c++) {
-      if (c->m_state == Connection::TIME_WAIT) {
-        if (e == m_conns.end() || c->m_timer > e->m_timer) {
-          e = c;
-        }
-      }
-    }
+  Status ret = accept(data, ntohl(INTCP->seqno) + 1, m_iss, e);
+  if (e == nullptr) {
+    return ret;
   }
   /*
-   * All connections are used already, we drop packet and hope that the remote
-   * end will retransmit the packet at a time when we have more spare
-   * connections.
+   * Use the send buffer for the SYN/ACK.
    */
-  if (e == m_conns.end()) {
-    m_stats.syndrop += 1;
-    return Status::Ok;
+  Segment& seg = e->nextAvailableSegment();
+  seg.set(1, e->m_snd_nxt, e->m_sdat); // TCP length of the SYN is one
+  e->resetSendBuffer();
+  /*
+   * Parse the TCP MSS option, if present.
+   */
+  if (INTCP->offset > 5) {
+    uint16_t nbytes = (INTCP->offset - 5) << 2;
+    Options::parse(*e, nbytes, data);
   }
+  setupWindowScale(*e);
+  setupTimestamps(*e);
   /*
-   * Update IP and Ethernet attributes
+   * Send the SYN/ACK
    */
-  m_ipv4to.setProtocol(ipv4::PROTO_TCP);
-  m_ipv4to.setDestinationAddress(m_ipv4from->sourceAddress());
-  m_ethto.setDestinationAddress(m_ethfrom->sourceAddress());
+  return sendSynAck(*e, e->segment());
+}
+
+Status
+Processor::accept(const uint8_t* const data, const uint32_t rcvnxt,
+                  const uint32_t sndnxt, Connection*& e)
+{
   /*
-   * Allocate a send buffer
+   * Take a connection from the free list, or recycle the oldest connection in
+   * TIME_WAIT.
    */
-  uint8_t* sdat;
-  Status ret = m_ipv4to.prepare(sdat);
-  if (ret != Status::Ok) {
-    return ret;
+  e = acquire();
+  /*
+   * All connections are used already, we drop packet and hope that the remote
+   * end will retransmit the packet at a time when we have more spare
+   * connections.
+   */
+  if (e == nullptr) {
+    m_stats.syndrop += 1;
+    return Status::Ok;
   }
   /*
    * Prepare the connection.
@@ -275,58 +538,141 @@ Processor::process(const uint16_t len, const uint8_t* const data)
   e->m_ripaddr = m_ipv4from->sourceAddress();
   e->m_lport = INTCP->destport;
   e->m_rport = INTCP->srcport;
-  e->m_rcv_nxt = ntohl(INTCP->seqno) + 1;
-  e->m_snd_nxt = m_iss;
+  e->m_rcv_nxt = rcvnxt;
+  e->m_snd_nxt = sndnxt;
   e->m_state = Connection::SYN_RCVD;
   e->m_opts = 0;
   e->m_ackdata = false;
   e->m_newdata = false;
   e->m_pshdata = false;
   e->m_wndscl = 0;
+  e->m_dupacks = 0;
+  e->m_recovery = false;
+  e->m_sackperm = false;
+  e->m_tsok = false;
   e->m_window = ntohs(INTCP->wnd);
   e->m_segidx = 0;
+  e->m_segcnt = 0;
   e->m_nrtx = 0; // Initial SYN send
   e->m_slen = 0;
   e->m_sdat = nullptr;
   e->m_initialmss = m_device.mtu() - HEADER_OVERHEAD;
   e->m_mss = e->m_initialmss;
-  e->m_sa = 0;
-  e->m_sv = 4; // Initial value of the RTT variance
-  e->m_rto = RTO;
-  e->m_timer = RTO;
+  e->m_srtt = 0;
+  e->m_rttvar = 0;
+  e->m_recover = e->m_snd_nxt;
+  e->m_ecnce = false;
+  e->m_ackpend = false;
+  e->m_nprobe = 0;
+  e->m_tsrecent = 0;
+  e->m_tsage = 0;
+  e->m_kalast = 0;
+  e->m_kaidle = KEEPALIVE_IDLE;
+  e->m_kaintvl = KEEPALIVE_INTVL;
+  e->m_kacnt = KEEPALIVE_COUNT;
+  e->m_kaprobe = 0;
+  e->m_rcvbuf = m_rcvbuf;
+  e->m_rcvcon = e->m_rcv_nxt;
+  e->m_rcvadv = e->m_rcv_nxt;
+  e->m_rcvwsc = 0;
+  e->m_wscok = false;
+  e->m_rcvdefer = false;
+  e->m_cc.reset(e->m_initialmss, e->m_snd_nxt);
   /*
-   * Prepare the connection segment.
+   * Register the connection tuple.
    */
-  Segment& seg = e->nextAvailableSegment();
-  seg.set(1, e->m_snd_nxt, sdat); // TCP length of the SYN is one
+  m_index.insert(e->m_ripaddr, e->m_rport, e->m_lport, e->m_id);
   /*
-   * Parse the TCP MSS option, if present.
+   * Track the connection as half-open until the handshake completes.
    */
-  if (INTCP->offset > 5) {
-    uint16_t nbytes = (INTCP->offset - 5) << 2;
-    Options::parse(*e, nbytes, data);
-  }
+  m_halfopen.push(e->m_id);
   /*
-   * Send the SYN/ACK
+   * Build the header template and allocate the send buffer.
    */
-  return sendSynAck(*e, seg);
+  setupTemplate(*e);
+  Status ret = prepare(*e, e->m_sdat);
+  if (ret != Status::Ok) {
+    release(*e);
+    e = nullptr;
+  }
+  return ret;
 }
 
-#if !(defined(TULIPS_HAS_HW_CHECKSUM) && defined(TULIPS_DISABLE_CHECKSUM_CHECK))
-uint16_t
-Processor::checksum(ipv4::Address const& src, ipv4::Address const& dst,
-                    const uint16_t len, const uint8_t* const data)
+Status
+Processor::acceptCookie(const uint16_t len, const uint8_t* const data)
 {
-  uint16_t sum;
+  const uint32_t seqno = ntohl(INTCP->seqno);
+  const uint32_t iss = ntohl(INTCP->ackno) - 1;
+  SynCookie::State st;
+  /*
+   * Reset the peer if the cookie is not valid.
+   */
+  if (!m_syncookie.check(m_ipv4from->sourceAddress(), INTCP->srcport,
+                         INTCP->destport, seqno - 1, iss,
+                         system::Clock::read(), st)) {
+    m_stats.ckerr += 1;
+    return reset(len, data);
+  }
+  /*
+   * The peer has proven that it owns its address. Make room for it by evicting
+   * the oldest half-open connection if none is available.
+   */
+  if (m_free.empty() && m_timewait.empty() && !m_halfopen.empty()) {
+    m_stats.syndrop += 1;
+    release(m_conns[m_halfopen.front()]);
+  }
+  /*
+   * Handle the new connection.
+   */
+  Connection* e;
+  Status ret = accept(data, seqno, iss + 1, e);
+  if (e == nullptr) {
+    return ret;
+  }
+  /*
+   * Restore the state of the handshake. The SYN/ACK has been sent, and the
+   * segment being processed acknowledges it: the connection is established.
+   */
+  e->m_wndscl = st.wsc;
+  e->m_wscok = st.wscok;
+  e->m_sackperm = st.sackperm;
+  e->m_initialmss = st.mss < e->m_initialmss ? st.mss : e->m_initialmss;
+  e->m_mss = e->m_initialmss;
+  e->m_cc.reset(e->m_initialmss, e->m_snd_nxt);
+  setupWindowScale(*e);
+  TCP_LOG("connection established");
+  m_halfopen.erase(e->m_id);
+  e->m_state = Connection::ESTABLISHED;
+  m_handler.onConnected(*e);
+  touch(*e);
   /*
-   * IP protocol and length fields. This addition cannot carry.
+   * Process the segment, as it may carry data.
    */
-  sum = len + ipv4::PROTO_TCP;
+  return process(*e, len, data);
+}
+
+uint16_t
+Processor::pseudoHeader(ipv4::Address const& src, ipv4::Address const& dst)
+{
+  uint16_t sum = ipv4::PROTO_TCP;
   /*
    * Sum IP source and destination addresses.
    */
   sum = utils::checksum(sum, (uint8_t*)&src, sizeof(src));
   sum = utils::checksum(sum, (uint8_t*)&dst, sizeof(dst));
+  return sum;
+}
+
+#if !(defined(TULIPS_HAS_HW_CHECKSUM) && defined(TULIPS_DISABLE_CHECKSUM_CHECK))
+uint16_t
+Processor::checksum(const uint16_t seed, const uint16_t len,
+                    const uint8_t* const data)
+{
+  /*
+   * Add the TCP length to the pseudo-header, with the end-around carry.
+   */
+  uint32_t acc = seed + len;
+  uint16_t sum = (acc & 0xFFFF) + (acc >> 16);
   /*
    * Sum TCP header and data.
    */
@@ -335,6 +681,40 @@ Processor::checksum(ipv4::Address const& src, ipv4::Address const& dst,
 }
 #endif
 
+#ifndef TULIPS_HAS_HW_CHECKSUM
+uint16_t
+Processor::checksum(const uint16_t seed, const uint16_t len,
+                    const uint8_t* const data, const uint16_t plen,
+                    const uint16_t psum)
+{
+  /*
+   * Add the TCP length to the pseudo-header, with the end-around carry.
+   */
+  uint32_t acc = seed + len + plen;
+  uint16_t sum = (acc & 0xFFFF) + (acc >> 16);
+  /*
+   * Sum TCP header, and add the sum of the data. The header length is even,
+   * so the data can be summed separately.
+   */
+  sum = utils::checksum(sum, data, len);
+  acc = sum + psum;
+  sum = (acc & 0xFFFF) + (acc >> 16);
+  return sum == 0 ? 0xffff : htons(sum);
+}
+#endif
+
+void
+Processor::releaseZeroCopy(Connection& e, const size_t count)
+{
+  for (size_t i = 0; i < count; i += 1) {
+    Segment& seg = e.segment(i);
+    if (unlikely(seg.m_zcopy)) {
+      m_handler.onReleased(e, payload(seg), seg.m_len);
+      seg.m_zcopy = false;
+    }
+  }
+}
+
 Status
 Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
 {
@@ -342,6 +722,17 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
   uint16_t window = ntohs(INTCP->wnd);
   const uint32_t seqno = ntohl(INTCP->seqno);
   const uint32_t ackno = ntohl(INTCP->ackno);
+  /*
+   * Deliver the segments held back during the burst, unless this segment
+   * follows them on the same connection.
+   */
+  if (m_grocid != Index::NONE &&
+      (m_grocid != e.m_id || !isCoalescable(e, len, data))) {
+    Status res = deliver();
+    if (res != Status::Ok) {
+      return res;
+    }
+  }
   /*
    * Reset connection data state
    */
@@ -355,8 +746,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
    */
   if (INTCP->flags & TCP_RST) {
     TCP_LOG("connection aborted");
-    m_device.unlisten(e.m_lport);
-    e.m_state = Connection::CLOSED;
+    release(e);
     m_handler.onAborted(e);
     return Status::Ok;
   }
@@ -366,6 +756,46 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
    */
   uint16_t tcpHdrLen = HEADER_LEN_WITH_OPTS(INTCP);
   plen = len - tcpHdrLen;
+  /*
+   * Check the timestamps of the segment (RFC 7323). Old duplicates are rejected
+   * (PAWS), otherwise TS.Recent is updated if the segment is not ahead of what
+   * we expect.
+   */
+  uint32_t tsval = 0, tsecr = 0;
+  bool hasts = false;
+  if (e.m_tsok && tcpHdrLen > HEADER_LEN) {
+    uint16_t nbytes = tcpHdrLen - HEADER_LEN;
+    hasts = Options::parseTimestamps(nbytes, data, tsval, tsecr);
+  }
+  if (hasts) {
+    system::Clock::Value now = system::Clock::read();
+    int64_t idle = now - e.m_tsage;
+    bool valid = idle < (int64_t)(PAWS_IDLE * CLOCK_SECOND);
+    if (valid && (int32_t)(tsval - e.m_tsrecent) < 0) {
+      TCP_LOG("PAWS reject: tsval=" << tsval << " recent=" << e.m_tsrecent);
+      m_stats.paws += 1;
+      if (plen > 0 || (INTCP->flags & (TCP_SYN | TCP_FIN)) != 0) {
+        return sendAck(e);
+      }
+      return Status::Ok;
+    }
+    if ((int32_t)(seqno - e.m_rcv_nxt) <= 0) {
+      e.m_tsrecent = tsval;
+      e.m_tsage = now;
+    }
+  }
+  /*
+   * Record the activity of the connection.
+   */
+  touch(e);
+  /*
+   * Remember if the data went through a congested hop, so that the mark can be
+   * echoed back to the peer (RFC 8257).
+   */
+  if (plen > 0) {
+    uint8_t ecn = m_ipv4from->typeOfService() & ipv4::ECN_MASK;
+    e.m_ecnce = ecn == ipv4::ECN_CE;
+  }
   /*
    * Print the flow information if requested.
    */
@@ -386,9 +816,32 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
        */
       if (seqno != e.m_rcv_nxt) {
         TCP_LOG("sequence ACK: in=" << seqno << " exp=" << e.m_rcv_nxt);
+        /*
+         * Keep the data received ahead of what we expect until the hole is
+         * filled.
+         */
+        if (plen > 0 && e.m_state == Connection::ESTABLISHED &&
+            (INTCP->flags & (TCP_SYN | TCP_FIN | TCP_URG)) == 0 &&
+            (int32_t)(seqno - e.m_rcv_nxt) > 0) {
+          if (m_ooo.insert(e.m_id, seqno, plen, data + tcpHdrLen)) {
+            m_stats.ooohit += 1;
+          } else {
+            m_stats.ooodrop += 1;
+          }
+          m_stats.ooodep = m_ooo.depth();
+        }
         return sendAck(e);
       }
     }
+    /*
+     * A segment without data that is behind what we expect is either a window
+     * probe or an old duplicate. Respond with our current window.
+     */
+    else if (e.m_state == Connection::ESTABLISHED &&
+             (int32_t)(seqno - e.m_rcv_nxt) < 0) {
+      TCP_LOG("probe ACK: in=" << seqno << " exp=" << e.m_rcv_nxt);
+      return sendAck(e);
+    }
   }
   /*
    * Check if the incoming segment acknowledges any outstanding data. If so, we
@@ -396,14 +849,26 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
    * calculate RTT estimations, and reset the retransmission timer.
    */
   if ((INTCP->flags & TCP_ACK) && e.hasOutstandingSegments()) {
+    system::Clock::Value tms = 0;
+    uint32_t flight = e.inflight();
+    uint32_t acked = 0;
+    size_t count = 0;
+    bool partial = false;
+    /*
+     * Mark the segments selectively acknowledged by the peer.
+     */
+    if (e.m_sackperm && INTCP->offset > 5) {
+      uint16_t nbytes = (INTCP->offset - 5) << 2;
+      Options::parseSack(e, nbytes, data);
+    }
     /*
      * Scan the segments.
      */
-    for (size_t i = 0; i < Connection::SEGMENT_COUNT; i += 1) {
+    for (; count < e.m_segcnt; count += 1) {
       /*
        * Get the oldest pending segment.
        */
-      Segment& seg = e.segment();
+      Segment& seg = e.segment(count);
       /*
        * Compute the expected ackno.
        */
@@ -421,26 +886,37 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
        */
       if (ackno == seg.m_seq) {
         /*
-         * In the case of a window size change.
+         * In the case of a window size change, the peer only updates its
+         * window: record it, nothing needs to be retransmitted (RFC 1122). It
+         * is not a duplicate ACK either.
          */
         if (e.window() != e.window(window)) {
           e.m_window = window;
           TCP_LOG("peer window updated to wnd: " << e.window()
                                                  << " on seq:" << ackno);
-          /*
-           * Do RTT estimation, unless we have done retransmissions. There is no
-           * reason to have a REXMIT at this point.
-           */
-          if (e.m_nrtx == 0) {
-            e.updateRttEstimation();
-            e.m_timer = e.m_rto;
-          }
+          break;
         }
         /*
-         * In the case of an OoO packet, let the ARQ do its job.
+         * In the case of an OoO packet, the peer sends a duplicate ACK: no
+         * data, no SYN nor FIN, and the same window (RFC 5681). Retransmit the
+         * missing segments on the third one. If we are already recovering
+         * from that loss, retransmit the new holes reported by SACK.
          */
-        TCP_LOG("peer rexmit request on seq:" << ackno);
-        return rexmit(e);
+        if (plen == 0 && (INTCP->flags & (TCP_SYN | TCP_FIN)) == 0 &&
+            e.m_state == Connection::ESTABLISHED) {
+          if (e.m_recovery) {
+            if (e.m_sackperm) {
+              return rexmitLost(e);
+            }
+          } else if (++e.m_dupacks == DUPACK_THRESHOLD) {
+            TCP_LOG("fast retransmit on seq:" << ackno);
+            m_stats.fastrx += 1;
+            e.m_cc.onLoss(e.algorithm(), e.m_initialmss, e.inflight());
+            e.startRecovery(false);
+            return rexmitLost(e);
+          }
+        }
+        break;
       }
       /*
        * Check if it's partial ACK (common with TSO). The first check covers the
@@ -454,12 +930,6 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
        * Housekeeping in case we have not processed an ACK yet.
        */
       if (!e.m_ackdata) {
-        /*
-         * Do RTT estimation, unless we have done retransmissions.
-         */
-        if (e.m_nrtx == 0) {
-          e.updateRttEstimation();
-        }
         /*
          * Clear the retransmission counter.
          */
@@ -468,25 +938,95 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
          * Set the acknowledged flag.
          */
         e.m_ackdata = true;
-        /*
-         * Reset the retransmission timer.
-         */
-        e.m_timer = e.m_rto;
       }
       /*
-       * Reset length and buffer of outstanding data and go to the next
-       * segment.  The compiler will generate the wrap-around appropriate for
-       * the bit length of the index.
+       * Keep the send time of the most recent segment that was not
+       * retransmitted (Karn's algorithm).
        */
-      seg.clear();
-      e.m_segidx += 1;
+      if (seg.m_tms != 0) {
+        tms = seg.m_tms;
+      }
+      /*
+       * Account for the acknowledged data and go to the next segment.
+       */
+      acked += seg.m_len;
       /*
        * Stop processing the segments if the ACK number is the one expected.
        */
       if (acklm == explm) {
+        count += 1;
         break;
       }
     }
+    /*
+     * Release the acknowledged segments, and hand the data they reference back
+     * to the application.
+     */
+    releaseZeroCopy(e, count);
+    e.releaseSegments(count);
+    /*
+     * Do RTT estimation using the echoed timestamp, which remains valid for
+     * retransmitted segments (RFC 7323). Otherwise, use the send time of the
+     * acknowledged segment.
+     */
+    if (e.m_ackdata && hasts && tsecr != 0) {
+      uint32_t rtt = timestamp() - tsecr;
+      e.updateRttEstimation((system::Clock::Value)rtt << TS_SHIFT);
+    } else if (tms != 0) {
+      e.updateRttEstimation(system::Clock::read() - tms);
+    }
+    /*
+     * New data has been acknowledged. If we are recovering from a loss, either
+     * all the data sent before the loss has been acknowledged and the recovery
+     * is over, or the next missing segment must be retransmitted (RFC 6582).
+     * Otherwise, the congestion window is updated.
+     */
+    if (e.m_ackdata) {
+      e.m_dupacks = 0;
+      if (e.m_recovery) {
+        if ((int32_t)(ackno - e.m_recover) >= 0) {
+          e.m_recovery = false;
+        } else {
+          partial = e.m_state == Connection::ESTABLISHED;
+        }
+      } else if (e.m_state == Connection::ESTABLISHED) {
+        Congestion::Algorithm algo = e.algorithm();
+        if (algo == Congestion::DCTCP) {
+          bool ece = (INTCP->flags & TCP_ECE) != 0;
+          e.m_cc.onEcn(e.m_initialmss, acked, ece, ackno, e.m_snd_nxt);
+        }
+        /*
+         * Only grow the window if it was fully used (RFC 7661).
+         */
+        if (flight + e.m_initialmss > e.m_cc.window()) {
+          system::Clock::Value srtt = (system::Clock::Value)e.m_srtt
+                                      << Connection::RTT_SHIFT;
+          e.m_cc.onAck(algo, e.m_initialmss, acked, srtt,
+                       system::Clock::read());
+        }
+      }
+    }
+    /*
+     * Reset the retransmission timer if some data is still in flight,
+     * otherwise stop it.
+     */
+    if (e.m_ackdata) {
+      if (e.hasOutstandingSegments()) {
+        setRexmitTimer(e);
+      } else {
+        m_timers.disarm(e.m_id, Timers::REXMIT);
+      }
+    }
+    /*
+     * Retransmit the missing segments on a partial ACK.
+     */
+    if (partial && e.hasOutstandingSegments()) {
+      TCP_LOG("partial ACK on seq:" << ackno);
+      Status ret = rexmitLost(e);
+      if (ret != Status::Ok) {
+        return ret;
+      }
+    }
   }
   /*
    * Do different things depending on in what state the connection is. CLOSED
@@ -506,11 +1046,13 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
        */
       if (e.m_ackdata) {
         TCP_LOG("connection established");
+        m_halfopen.erase(e.m_id);
         /*
          * Send the connection event.
          */
         e.m_state = Connection::ESTABLISHED;
         m_handler.onConnected(e);
+        touch(e);
         /*
          * Send the newdata event. Pass the packet data directly. At this stage,
          * no data has been buffered.
@@ -549,10 +1091,15 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
           uint16_t nbytes = (INTCP->offset - 5) << 2;
           Options::parse(e, nbytes, data);
         }
+        e.m_rcvcon = e.m_rcv_nxt;
+        e.m_rcvadv = e.m_rcv_nxt;
+        setupWindowScale(e);
+        setupTimestamps(e);
         /*
          * Send the connected event.
          */
         m_handler.onConnected(e);
+        touch(e);
         /*
          * Send the newdata event. Pass the packet data directly. At this stage,
          * no data has been buffered.
@@ -612,7 +1159,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
         TCP_LOG("connection last ACK");
         e.m_state = Connection::LAST_ACK;
         Segment& seg = e.nextAvailableSegment();
-        seg.set(1, e.m_snd_nxt, e.m_sdat);
+        seg.set(1, e.m_snd_nxt, e.m_sdat, e.headerLength());
         e.resetSendBuffer();
         return sendFinAck(e, seg);
       }
@@ -631,10 +1178,19 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
        * the application has stopped the dataflow using stop(), we must not
        * accept any data packets from the remote host.
        */
+      const uint8_t* dataptr = data + tcpHdrLen + urglen;
+      uint32_t datalen = plen;
       if (plen > 0 && e.m_state != Connection::STOPPED) {
         e.m_newdata = true;
         e.m_pshdata = (INTCP->flags & TCP_PSH) == TCP_PSH;
-        e.m_rcv_nxt += plen;
+        /*
+         * Deliver the out-of-order data that follows in the same batch.
+         */
+        if (unlikely(!m_ooo.empty(e.m_id))) {
+          datalen = m_ooo.merge(e.m_id, e.m_rcv_nxt, dataptr, plen, dataptr);
+          m_stats.ooodep = m_ooo.depth();
+        }
+        e.m_rcv_nxt += datalen;
       }
       /*
        * Update the peer window value.
@@ -651,15 +1207,41 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
       }
       /*
        * If the remote host advertises a zero window or a window larger than the
-       * initial negotiated window, we set the MSS to the initial MSS so that
-       * the application will send an entire MSS of data. This data will not be
-       * acknowledged by the receiver, and the application will retransmit it.
-       * This is called the "persistent timer" and uses the retransmission
-       * mechanim.
+       * initial negotiated window, we set the MSS to the initial MSS.
        */
       else {
         e.m_mss = e.m_initialmss;
       }
+      /*
+       * If the remote host advertises a zero window while no data is in flight,
+       * the update that re-opens it may be lost. Probe the window until it is
+       * re-opened (RFC 1122). Otherwise, the retransmissions probe the window.
+       */
+      if (e.m_window == 0 && !e.hasOutstandingSegments()) {
+        if (!m_timers.armed(e.m_id, Timers::PERSIST)) {
+          e.m_nprobe = 0;
+          setPersistTimer(e, system::Clock::read());
+        }
+      } else if (m_timers.armed(e.m_id, Timers::PERSIST)) {
+        m_timers.disarm(e.m_id, Timers::PERSIST);
+        e.m_nprobe = 0;
+      }
+      /*
+       * Within a burst, hold back the in-order data that does not acknowledge
+       * anything. It is delivered with the segments that follow it.
+       */
+      if (m_burst && HAS_COALESCE(e) && e.m_newdata && !e.m_ackdata &&
+          urglen == 0 && datalen == plen) {
+        m_grocid = e.m_id;
+        m_grofrags.push_back({ (uint16_t)datalen, dataptr });
+        return m_grofrags.size() == GRO_DEPTH ? deliver() : Status::Ok;
+      }
+      if (m_grocid == e.m_id) {
+        Status res = deliver();
+        if (res != Status::Ok) {
+          return res;
+        }
+      }
       /*
        * If this packet constitutes an ACK for outstanding data (flagged by the
        * ACKDATA flag, we should call the application since it might want to
@@ -671,7 +1253,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
         /*
          * Check if the application can send.
          */
-        bool can_send = e.hasAvailableSegments() && e.window() > e.m_slen;
+        bool can_send = e.canSend() && e.window() > e.m_slen;
         /*
          * Notify the application on an ACK.
          */
@@ -682,13 +1264,13 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
            */
           if (likely(can_send)) {
             uint32_t rlen = 0;
-            uint32_t bound = e.window() < m_mss ? e.window() : m_mss;
+            uint32_t bound = sendBound(e);
             uint32_t alen = bound - e.m_slen;
             /*
              * The application can send back some data.
              */
-            switch (m_handler.onAcked(e, alen, e.m_sdat + HEADER_LEN + e.m_slen,
-                                      rlen)) {
+            uint8_t* sdat = e.m_sdat + e.headerLength() + e.m_slen;
+            switch (m_handler.onAcked(e, alen, sdat, rlen)) {
               case Action::Abort:
                 return sendAbort(e);
               case Action::Close:
@@ -706,7 +1288,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
             /*
              * Update the send state.
              */
-            can_send = e.hasAvailableSegments() && e.window() > e.m_slen;
+            can_send = e.canSend() && e.window() > e.m_slen;
           }
           /*
            * If we cannot send anything, just notify the application.
@@ -722,11 +1304,6 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
             }
           }
         }
-        /*
-         * Collect the connection's buffer state.
-         */
-        const uint8_t* dataptr = data + tcpHdrLen + urglen;
-        const uint32_t datalen = plen;
         /*
          * Notify the application on new data.
          */
@@ -750,13 +1327,13 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
            */
           if (likely(can_send)) {
             uint32_t rlen = 0;
-            uint32_t bound = e.window() < m_mss ? e.window() : m_mss;
+            uint32_t bound = sendBound(e);
             uint32_t alen = bound - e.m_slen;
             /*
              * The application can send back some data.
              */
             switch (m_handler.onNewData(e, dataptr, datalen, alen,
-                                        e.m_sdat + HEADER_LEN + e.m_slen,
+                                        e.m_sdat + e.headerLength() + e.m_slen,
                                         rlen)) {
               case Action::Abort:
                 return sendAbort(e);
@@ -798,10 +1375,15 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
         }
         /*
          * If the connection supports DELAYED_ACK and could/dit not send
-         * anything, ACK if necessary.
+         * anything, delay the ACK until the next flush. Every second segment
+         * is acknowledged right away (RFC 1122), and so is a segment that
+         * fills a hole in the sequence space (RFC 5681).
          */
         if (HAS_DELAYED_ACK(e) && e.m_newdata) {
-          return sendAck(e);
+          if (e.m_ackpend || datalen != plen) {
+            return sendAck(e);
+          }
+          delayAck(e);
         }
         /*
          * Otherwise do nothing
@@ -817,8 +1399,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
     case Connection::LAST_ACK: {
       if (e.m_ackdata) {
         TCP_LOG("connection closed");
-        m_device.unlisten(e.m_lport);
-        e.m_state = Connection::CLOSED;
+        release(e);
         m_handler.onClosed(e);
       }
       break;
@@ -839,7 +1420,8 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
         if (e.m_ackdata) {
           TCP_LOG("connection time-wait");
           e.m_state = Connection::TIME_WAIT;
-          e.m_timer = 0;
+          m_timewait.push(e.m_id);
+          setWaitTimer(e);
         } else {
           TCP_LOG("connection closing");
           e.m_state = Connection::CLOSING;
@@ -854,6 +1436,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
       else if (e.m_ackdata) {
         TCP_LOG("Connection FIN wait #2");
         e.m_state = Connection::FIN_WAIT_2;
+        setWaitTimer(e);
         return Status::Ok;
       }
       /*
@@ -875,7 +1458,8 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
         TCP_LOG("connection time-wait");
         e.m_state = Connection::TIME_WAIT;
         e.m_rcv_nxt += 1;
-        e.m_timer = 0;
+        m_timewait.push(e.m_id);
+        setWaitTimer(e);
         m_handler.onClosed(e);
         return sendAck(e);
       }
@@ -907,7 +1491,7 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
       TCP_LOG("connection FIN wait #1");
       e.m_state = Connection::FIN_WAIT_1;
       Segment& seg = e.nextAvailableSegment();
-      seg.set(1, e.m_snd_nxt, e.m_sdat);
+      seg.set(1, e.m_snd_nxt, e.m_sdat, e.headerLength());
       e.resetSendBuffer();
       /*
        * If there is some new data, ignore it.
@@ -927,7 +1511,8 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
       if (e.m_ackdata) {
         TCP_LOG("connection time-wait");
         e.m_state = Connection::TIME_WAIT;
-        e.m_timer = 0;
+        m_timewait.push(e.m_id);
+        setWaitTimer(e);
       }
       break;
     }
@@ -946,6 +1531,79 @@ Processor::process(Connection& e, const uint16_t len, const uint8_t* const data)
   return Status::Ok;
 }
 
+Connection*
+Processor::acquire()
+{
+  /*
+   * If no connection is free, recycle the oldest connection in TIME_WAIT. The
+   * queue is ordered by TIME_WAIT entry time, so that connection is at its
+   * front.
+   */
+  if (m_free.empty()) {
+    if (m_timewait.empty()) {
+      return nullptr;
+    }
+    release(m_conns[m_timewait.front()]);
+  }
+  /*
+   * Pop the connection from the free list.
+   */
+  Connection::ID id = m_free.back();
+  m_free.pop_back();
+  return &m_conns[id];
+}
+
+void
+Processor::release(Connection& e)
+{
+  /*
+   * Nothing to do if the connection is already closed.
+   */
+  if (e.m_state == Connection::CLOSED) {
+    return;
+  }
+  /*
+   * Remove the connection from the lookup table, the half-open queue and the
+   * TIME_WAIT queue.
+   */
+  m_index.erase(e.m_ripaddr, e.m_rport, e.m_lport);
+  m_halfopen.erase(e.m_id);
+  m_timewait.erase(e.m_id);
+  m_timers.clear(e.m_id);
+  m_ooo.clear(e.m_id);
+  m_stats.ooodep = m_ooo.depth();
+  /*
+   * Hand the data referenced by the outstanding segments back to the
+   * application.
+   */
+  releaseZeroCopy(e, e.m_segcnt);
+  /*
+   * Drop the segments held back during the burst, if any.
+   */
+  if (m_grocid == e.m_id) {
+    m_grocid = Index::NONE;
+    m_grofrags.clear();
+  }
+  /*
+   * Drop the delayed ACK, if any. The connection is removed from the delayed
+   * ACK queue at the next flush.
+   */
+  e.m_ackpend = false;
+  /*
+   * Release the local port and its filter if it was allocated by connect().
+   */
+  Port lport = ntohs(e.m_lport);
+  if (isPortUsed(lport)) {
+    m_lports[lport >> 6] &= ~(1ULL << (lport & 0x3F));
+    m_device.unlisten(lport);
+  }
+  /*
+   * Put the connection back in the free list.
+   */
+  e.m_state = Connection::CLOSED;
+  m_free.push_back(e.m_id);
+}
+
 Status
 Processor::reset(const uint16_t UNUSED len, const uint8_t* const data)
 {
@@ -953,6 +1611,7 @@ Processor::reset(const uint16_t UNUSED len, const uint8_t* const data)
    * Update IP and Ethernet attributes
    */
   m_ipv4to.setProtocol(ipv4::PROTO_TCP);
+  m_ipv4to.setTypeOfService(ipv4::ECN_NOT_ECT);
   m_ipv4to.setDestinationAddress(m_ipv4from->sourceAddress());
   m_ethto.setDestinationAddress(m_ethfrom->sourceAddress());
   /*
@@ -989,7 +1648,9 @@ Processor::reset(const uint16_t UNUSED len, const uint8_t* const data)
    * And send out the RST packet!
    */
   uint16_t mss = m_device.mtu() - HEADER_OVERHEAD;
-  return send(m_ipv4from->sourceAddress(), HEADER_LEN, mss, outdata);
+  uint16_t seed =
+    pseudoHeader(m_ipv4to.hostAddress(), m_ipv4from->sourceAddress());
+  return send(seed, HEADER_LEN, mss, outdata);
 }
 
 }}}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Reassembly.h>
+#include <cstring>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+constexpr uint32_t Reassembly::NIL;
+
+Reassembly::Reassembly(const size_t nconn, const size_t nbufs,
+                       const size_t depth, const size_t bufsz)
+  : m_depth(depth)
+  , m_bufsz(bufsz)
+  , m_entries(nbufs)
+  , m_data(nbufs * bufsz)
+  , m_free()
+  , m_head(nconn, NIL)
+  , m_count(nconn, 0)
+  , m_batch((depth + 1) * bufsz)
+{
+  m_free.reserve(nbufs);
+  for (size_t i = 0; i < nbufs; i += 1) {
+    m_free.push_back(nbufs - i - 1);
+  }
+}
+
+bool
+Reassembly::insert(const Connection::ID id, const uint32_t seq,
+                   const uint32_t len, const uint8_t* const data)
+{
+  /*
+   * Find where the segment goes. Skip it if it is already queued.
+   */
+  uint32_t* link = &m_head[id];
+  while (*link != NIL && (int32_t)(m_entries[*link].m_seq - seq) < 0) {
+    link = &m_entries[*link].m_next;
+  }
+  if (*link != NIL && m_entries[*link].m_seq == seq &&
+      m_entries[*link].m_len >= len) {
+    return true;
+  }
+  /*
+   * Check the bounds.
+   */
+  if (len > m_bufsz || m_count[id] == m_depth || m_free.empty()) {
+    return false;
+  }
+  /*
+   * Copy the segment and link it.
+   */
+  uint32_t idx = m_free.back();
+  m_free.pop_back();
+  memcpy(buffer(idx), data, len);
+  m_entries[idx].m_seq = seq;
+  m_entries[idx].m_len = len;
+  m_entries[idx].m_next = *link;
+  *link = idx;
+  m_count[id] += 1;
+  return true;
+}
+
+uint32_t
+Reassembly::merge(const Connection::ID id, const uint32_t seq,
+                  const uint8_t* const data, const uint32_t len,
+                  const uint8_t*& out)
+{
+  uint32_t next = seq + len;
+  uint32_t total = len;
+  out = data;
+  /*
+   * Consume the buffers, in sequence order, until a hole is found.
+   */
+  while (m_head[id] != NIL) {
+    const uint32_t idx = m_head[id];
+    Entry const& e = m_entries[idx];
+    const uint32_t end = e.m_seq + e.m_len;
+    if ((int32_t)(e.m_seq - next) > 0) {
+      break;
+    }
+    /*
+     * Copy the part of the buffer that has not been received yet.
+     */
+    if ((int32_t)(end - next) > 0) {
+      const uint32_t off = next - e.m_seq;
+      const uint32_t cnt = e.m_len - off;
+      if (out == data) {
+        if (m_batch.size() < len + m_depth * m_bufsz) {
+          m_batch.resize(len + m_depth * m_bufsz);
+        }
+        memcpy(m_batch.data(), data, len);
+        out = m_batch.data();
+      }
+      memcpy(&m_batch[total], buffer(idx) + off, cnt);
+      total += cnt;
+      next = end;
+    }
+    m_head[id] = e.m_next;
+    m_count[id] -= 1;
+    release(idx);
+  }
+  return total;
+}
+
+void
+Reassembly::clear(const Connection::ID id)
+{
+  while (m_head[id] != NIL) {
+    const uint32_t idx = m_head[id];
+    m_head[id] = m_entries[idx].m_next;
+    release(idx);
+  }
+  m_count[id] = 0;
+}
+
+}}}
@@ -29,6 +29,17 @@
 
 namespace tulips { namespace stack { namespace tcpv4 {
 
-Segment::Segment() : m_len(0), m_seq(0), m_dat(nullptr) {}
+Segment::Segment()
+  : m_len(0)
+  , m_seq(0)
+  , m_dat(nullptr)
+  , m_tms(0)
+  , m_sacked(false)
+  , m_rexmit(false)
+  , m_zcopy(false)
+  , m_hlen(HEADER_LEN)
+  , m_sum(0)
+  , m_summed(false)
+{}
 
 }}}
@@ -37,6 +37,8 @@
 #include <arpa/inet.h>
 #endif
 
+#define INTCP ((const Header*)data)
+
 namespace tulips { namespace stack { namespace tcpv4 {
 
 Status
@@ -47,7 +49,7 @@ Processor::sendNagle(Connection& e, const uint32_t bound)
    */
   if (e.m_slen == bound) {
     Segment& seg = e.nextAvailableSegment();
-    seg.set(e.m_slen, e.m_snd_nxt, e.m_sdat);
+    seg.set(e.m_slen, e.m_snd_nxt, e.m_sdat, e.headerLength());
     e.resetSendBuffer();
     return send(e, seg, TCP_PSH);
   }
@@ -67,7 +69,7 @@ Status
 Processor::sendNoDelay(Connection& e, const uint8_t flag)
 {
   Segment& seg = e.nextAvailableSegment();
-  seg.set(e.m_slen, e.m_snd_nxt, e.m_sdat);
+  seg.set(e.m_slen, e.m_snd_nxt, e.m_sdat, e.headerLength());
   e.resetSendBuffer();
   return send(e, seg, flag);
 }
@@ -76,8 +78,7 @@ Status
 Processor::sendAbort(Connection& e)
 {
   TCP_LOG("connection RST");
-  m_device.unlisten(e.m_lport);
-  e.m_state = Connection::CLOSED;
+  release(e);
   uint8_t* outdata = e.m_sdat;
   OUTTCP->flags = TCP_RST;
   OUTTCP->flags |= e.m_newdata ? TCP_ACK : 0;
@@ -104,7 +105,7 @@ Processor::sendClose(Connection& e)
   TCP_LOG("connection FIN wait #1");
   e.m_state = Connection::FIN_WAIT_1;
   Segment& seg = e.nextAvailableSegment();
-  seg.set(1, e.m_snd_nxt, e.m_sdat);
+  seg.set(1, e.m_snd_nxt, e.m_sdat, e.headerLength());
   e.resetSendBuffer();
   return sendFinAck(e, seg);
 }
@@ -113,80 +114,260 @@ Status
 Processor::sendAck(Connection& e)
 {
   uint8_t* outdata = e.m_sdat;
-  Status res;
+  uint32_t len = HEADER_LEN;
   /*
-   * An ACK might be sent even though there is pending data in the send buffer.
-   * In that case, we should not erase that data and use a new buffer.
+   * Without data pending in the send buffer, the ACK uses it.
    */
-  if (unlikely(e.hasPendingSendData())) {
-    res = m_device.prepare(outdata);
-    if (res != Status::Ok) {
-      TCP_LOG("prepare() for sendAck() failed");
-      return res;
-    }
+  if (likely(!e.hasPendingSendData())) {
+    OUTTCP->flags = TCP_ACK;
+    OUTTCP->offset = 5;
+    return send(e);
   }
   /*
-   * Prepare the frame for an ACK.
+   * Otherwise, use a buffer of its own so as not to erase the pending data.
    */
+  Status ret = prepare(e, outdata);
+  if (ret != Status::Ok) {
+    TCP_LOG("prepare() for sendAck() failed");
+    return ret;
+  }
   OUTTCP->flags = TCP_ACK;
   OUTTCP->offset = 5;
-  return send(e);
+  OUTTCP->ackno = htonl(e.m_rcv_nxt);
+  OUTTCP->seqno = htonl(e.m_snd_nxt);
+  e.m_ackpend = false;
+  /*
+   * Echo the CE mark of the last data segment received (RFC 8257).
+   */
+  if (e.m_ecnce) {
+    OUTTCP->flags |= TCP_ECE;
+  }
+  OUTTCP->wnd = htons(receiveWindow(e, OUTTCP->flags));
+  /*
+   * Add the timestamps, if in use.
+   */
+  if (e.m_tsok) {
+    writeTimestamps(e, OUTTCP->opts);
+    OUTTCP->offset = e.headerLength() >> 2;
+    len = e.headerLength();
+  }
+  TCP_FLOW("<- " << getFlags(*OUTTCP) << " len:0 seq:" << e.m_snd_nxt
+                 << " ack:" << e.m_rcv_nxt);
+  return send(e.m_hdrsum, len, e.m_mss, outdata);
+}
+
+Status
+Processor::sendProbe(Connection& e)
+{
+  uint8_t* outdata;
+  uint32_t len = HEADER_LEN;
+  /*
+   * Use a buffer of its own, as data may be pending in the send buffer.
+   */
+  Status ret = prepare(e, outdata);
+  if (ret != Status::Ok) {
+    TCP_LOG("prepare() for sendProbe() failed");
+    return ret;
+  }
+  /*
+   * The probe carries no data and a sequence number the peer has already
+   * acknowledged, so that the peer responds with an ACK that carries its
+   * current window.
+   */
+  OUTTCP->flags = TCP_ACK;
+  OUTTCP->offset = 5;
+  OUTTCP->ackno = htonl(e.m_rcv_nxt);
+  OUTTCP->seqno = htonl(e.m_snd_nxt - 1);
+  OUTTCP->wnd = htons(receiveWindow(e, OUTTCP->flags));
+  e.m_ackpend = false;
+  /*
+   * Add the timestamps, if in use.
+   */
+  if (e.m_tsok) {
+    writeTimestamps(e, OUTTCP->opts);
+    OUTTCP->offset = e.headerLength() >> 2;
+    len = e.headerLength();
+  }
+  TCP_FLOW("<- " << getFlags(*OUTTCP) << " len:0 seq:" << e.m_snd_nxt - 1
+                 << " ack:" << e.m_rcv_nxt << " probe:" << (int)e.m_nprobe);
+  return send(e.m_hdrsum, len, e.m_mss, outdata);
 }
 
 Status
 Processor::sendSyn(Connection& e, Segment& s)
 {
   uint8_t* outdata = s.m_dat;
-  uint16_t len = HEADER_LEN + Options::MSS_LEN + Options::WSC_LEN + 1;
+  uint8_t* opts = OUTTCP->opts;
+  /*
+   * We offer timestamps in our SYN if enabled, and in our SYNACK if they are
+   * in use.
+   */
+  const bool tso = OUTTCP->flags & TCP_ACK ? e.m_tsok : m_timestamps;
+  uint16_t len =
+    HEADER_LEN + Options::MSS_LEN + Options::WSC_LEN + Options::SAP_LEN + 3;
+  if (tso) {
+    len += Options::TSO_PAD;
+    writeTimestamps(e, opts);
+    opts += Options::TSO_PAD;
+  }
   OUTTCP->flags |= TCP_SYN;
   OUTTCP->offset = len >> 2;
   /*
-   * We send out the TCP Maximum Segment Size option with our SYNACK.
+   * The advertised MSS does not account for the options sent with every
+   * segment. We permit SACK in our SYN, and in our SYNACK if the peer
+   * permitted it.
    */
-  OUTTCP->opts[0] = Options::WSC;
-  OUTTCP->opts[1] = Options::WSC_LEN;
-  OUTTCP->opts[2] = m_device.receiveBufferLengthLog2();
-  OUTTCP->opts[3] = Options::MSS;
-  OUTTCP->opts[4] = Options::MSS_LEN;
+  uint16_t mss = e.m_initialmss + (e.headerLength() - HEADER_LEN);
+  bool sap = !(OUTTCP->flags & TCP_ACK) || e.m_sackperm;
+  writeSynOptions(opts, mss, sap);
+  return send(e, len, s);
+}
+
+Status
+Processor::sendCookie(const uint8_t* const data)
+{
   /*
-   * Update the MSS value.
+   * Parse the options of the SYN in a scratch connection.
    */
-  auto* mssval = (uint16_t*)&OUTTCP->opts[5];
-  *mssval = htons(e.m_initialmss);
-  OUTTCP->opts[7] = Options::END;
-  return send(e, len, s);
+  Connection syn;
+  syn.m_initialmss = m_device.mtu() - HEADER_OVERHEAD;
+  syn.m_rcvbuf = m_rcvbuf;
+  if (INTCP->offset > 5) {
+    uint16_t nbytes = (INTCP->offset - 5) << 2;
+    Options::parse(syn, nbytes, data);
+  }
+  /*
+   * Encode the state of the handshake in the cookie.
+   */
+  const uint32_t seqno = ntohl(INTCP->seqno);
+  SynCookie::State st = { syn.m_initialmss, (uint8_t)syn.m_wndscl,
+                          syn.m_wscok, (bool)syn.m_sackperm };
+  uint32_t cookie =
+    m_syncookie.make(m_ipv4from->sourceAddress(), INTCP->srcport,
+                     INTCP->destport, seqno, st, system::Clock::read());
+  /*
+   * Update IP and Ethernet attributes
+   */
+  m_ipv4to.setProtocol(ipv4::PROTO_TCP);
+  m_ipv4to.setTypeOfService(ipv4::ECN_NOT_ECT);
+  m_ipv4to.setDestinationAddress(m_ipv4from->sourceAddress());
+  m_ethto.setDestinationAddress(m_ethfrom->sourceAddress());
+  /*
+   * Allocate the send buffer
+   */
+  uint8_t* outdata;
+  Status ret = m_ipv4to.prepare(outdata);
+  if (ret != Status::Ok) {
+    return ret;
+  }
+  /*
+   * Send the SYN/ACK, without timestamps.
+   */
+  const uint16_t mss = m_device.mtu() - HEADER_OVERHEAD;
+  const uint16_t len =
+    HEADER_LEN + Options::MSS_LEN + Options::WSC_LEN + Options::SAP_LEN + 3;
+  OUTTCP->srcport = INTCP->destport;
+  OUTTCP->destport = INTCP->srcport;
+  OUTTCP->seqno = htonl(cookie);
+  OUTTCP->ackno = htonl(seqno + 1);
+  OUTTCP->flags = TCP_SYN | TCP_ACK;
+  OUTTCP->offset = len >> 2;
+  OUTTCP->wnd = htons(receiveWindow(syn, TCP_SYN));
+  writeSynOptions(OUTTCP->opts, mss, st.sackperm);
+  m_stats.cookie += 1;
+  uint16_t seed =
+    pseudoHeader(m_ipv4to.hostAddress(), m_ipv4from->sourceAddress());
+  return send(seed, len, mss, outdata);
+}
+
+void
+Processor::writeSynOptions(uint8_t* const opts, const uint16_t mss,
+                           const bool sackperm) const
+{
+  opts[0] = Options::WSC;
+  opts[1] = Options::WSC_LEN;
+  opts[2] = m_rcvwsc;
+  opts[3] = Options::MSS;
+  opts[4] = Options::MSS_LEN;
+  *(uint16_t*)&opts[5] = htons(mss);
+  if (sackperm) {
+    opts[7] = Options::SAP;
+    opts[8] = Options::SAP_LEN;
+  } else {
+    opts[7] = Options::NOOP;
+    opts[8] = Options::NOOP;
+  }
+  opts[9] = Options::END;
+  opts[10] = Options::END;
+  opts[11] = Options::END;
+}
+
+uint16_t
+Processor::receiveWindow(Connection& e, const uint8_t flags)
+{
+  /*
+   * If the connection has issued stop(), we advertise a zero window so
+   * that the remote host will stop sending data.
+   */
+  if (e.m_state == Connection::STOPPED) {
+    return 0;
+  }
+  uint32_t space = e.receiveSpace();
+  /*
+   * The window of a SYN is never scaled.
+   */
+  if (flags & TCP_SYN) {
+    uint16_t window = utils::cap(space);
+    e.m_rcvadv = e.m_rcv_nxt + window;
+    return window;
+  }
+  /*
+   * The window is not shrunk, and only opened if that is not silly. It is
+   * rounded up to the granularity of the scale (RFC 7323 2.4).
+   */
+  uint32_t window = e.canOpenWindow(space) ? space : e.advertisedSpace();
+  uint32_t mask = (1UL << e.m_rcvwsc) - 1;
+  window = (window + mask) >> e.m_rcvwsc;
+  window = window > 0xFFFF ? 0xFFFF : window;
+  e.m_rcvadv = e.m_rcv_nxt + (window << e.m_rcvwsc);
+  return window;
 }
 
 Status
 Processor::send(Connection& e)
 {
   uint8_t* outdata = e.m_sdat;
+  uint32_t len = HEADER_LEN;
   /*
    * We're done with the input processing. We are now ready to send a reply. Our
-   * job is to fill in all the fields of the TCP and IP headers before
-   * calculating the checksum and finally send the packet.
+   * job is to fill in the fields of the TCP header that are not part of the
+   * template before calculating the checksum and finally send the packet.
    */
   OUTTCP->ackno = htonl(e.m_rcv_nxt);
   OUTTCP->seqno = htonl(e.m_snd_nxt);
-  OUTTCP->srcport = e.m_lport;
-  OUTTCP->destport = e.m_rport;
   /*
-   * If the connection has issued stop(), we advertise a zero window so
-   * that the remote host will stop sending data.
+   * This segment carries the delayed ACK, if any.
    */
-  if (e.m_state == Connection::STOPPED) {
-    OUTTCP->wnd = 0;
-  } else if (OUTTCP->flags & TCP_SYN) {
-    uint32_t window = m_device.receiveBuffersAvailable()
-                      << m_device.receiveBufferLengthLog2();
-    OUTTCP->wnd = htons(utils::cap(window));
-  } else {
-    OUTTCP->wnd = htons(m_device.receiveBuffersAvailable());
+  e.m_ackpend = false;
+  /*
+   * Echo the CE mark of the last data segment received (RFC 8257).
+   */
+  if (e.m_ecnce && !(OUTTCP->flags & TCP_SYN)) {
+    OUTTCP->flags |= TCP_ECE;
+  }
+  OUTTCP->wnd = htons(receiveWindow(e, OUTTCP->flags));
+  /*
+   * Add the timestamps, if in use.
+   */
+  if (e.m_tsok) {
+    writeTimestamps(e, OUTTCP->opts);
+    OUTTCP->offset = e.headerLength() >> 2;
+    len = e.headerLength();
   }
   /*
    * Reallocate the send buffer before sending
    */
-  Status ret = send(e.m_ripaddr, HEADER_LEN, e.m_mss, e.m_sdat);
+  Status ret = send(e.m_hdrsum, len, e.m_mss, e.m_sdat);
   if (ret != Status::Ok) {
     return ret;
   }
@@ -195,16 +376,10 @@ Processor::send(Connection& e)
    */
   TCP_FLOW("<- " << getFlags(*OUTTCP) << " len:0 seq:" << e.m_snd_nxt
                  << " ack:" << e.m_rcv_nxt);
-  /*
-   * Update IP and Ethernet attributes
-   */
-  m_ipv4to.setProtocol(ipv4::PROTO_TCP);
-  m_ipv4to.setDestinationAddress(e.m_ripaddr);
-  m_ethto.setDestinationAddress(e.m_rethaddr);
   /*
    * Prepare a new buffer
    */
-  return m_ipv4to.prepare(e.m_sdat);
+  return prepare(e, e.m_sdat);
 }
 
 Status
@@ -214,30 +389,32 @@ Processor::send(Connection& e, const uint32_t len, Segment& s)
   const bool rexmit = s.m_seq != e.m_snd_nxt;
   /*
    * We're done with the input processing. We are now ready to send a reply. Our
-   * job is to fill in all the fields of the TCP and IP headers before
-   * calculating the checksum and finally send the packet.
+   * job is to fill in the fields of the TCP header that are not part of the
+   * template before calculating the checksum and finally send the packet.
    */
   OUTTCP->ackno = htonl(e.m_rcv_nxt);
   OUTTCP->seqno = htonl(s.m_seq);
-  OUTTCP->srcport = e.m_lport;
-  OUTTCP->destport = e.m_rport;
   /*
-   * If the connection has issued stop(), we advertise a zero window so
-   * that the remote host will stop sending data.
+   * This segment carries the delayed ACK, if any.
    */
-  if (e.m_state == Connection::STOPPED) {
-    OUTTCP->wnd = 0;
-  } else if (OUTTCP->flags & TCP_SYN) {
-    uint32_t window = m_device.receiveBuffersAvailable()
-                      << m_device.receiveBufferLengthLog2();
-    OUTTCP->wnd = htons(utils::cap(window));
-  } else {
-    OUTTCP->wnd = htons(m_device.receiveBuffersAvailable());
+  e.m_ackpend = false;
+  /*
+   * Echo the CE mark of the last data segment received (RFC 8257).
+   */
+  if (e.m_ecnce && !(OUTTCP->flags & TCP_SYN)) {
+    OUTTCP->flags |= TCP_ECE;
   }
+  OUTTCP->wnd = htons(receiveWindow(e, OUTTCP->flags));
   /*
-   * Reallocate the send buffer before sending
+   * Add the timestamps, if in use. They are refreshed when retransmitting.
+   */
+  if (s.m_hlen > HEADER_LEN) {
+    writeTimestamps(e, OUTTCP->opts);
+  }
+  /*
+   * Reallocate the send buffer before sending.
    */
-  Status ret = send(e.m_ripaddr, len, e.m_mss, outdata);
+  Status ret = sendSegment(e, len, s);
   if (ret != Status::Ok) {
     return ret;
   }
@@ -258,21 +435,69 @@ Processor::send(Connection& e, const uint32_t len, Segment& s)
     }
 #endif
     e.m_snd_nxt += s.m_len;
+    s.m_tms = system::Clock::read();
+    /*
+     * Start the retransmission timer if it is not running.
+     */
+    if (!m_timers.armed(e.m_id, Timers::REXMIT)) {
+      setRexmitTimer(e);
+    }
   }
   /*
-   * Update IP and Ethernet attributes
+   * Do not use retransmitted segments for RTT estimation.
    */
-  m_ipv4to.setProtocol(ipv4::PROTO_TCP);
-  m_ipv4to.setDestinationAddress(e.m_ripaddr);
-  m_ethto.setDestinationAddress(e.m_rethaddr);
+  else {
+    s.m_tms = 0;
+  }
+  /*
+   * Keep the send buffer if it was not used, which is the case when
+   * retransmitting with pending data.
+   */
+  if (unlikely(e.m_sdat != nullptr)) {
+    return Status::Ok;
+  }
   /*
    * Prepare a new buffer
    */
-  return m_ipv4to.prepare(e.m_sdat);
+  return prepare(e, e.m_sdat);
+}
+
+void
+Processor::setupTemplate(Connection& e)
+{
+  uint8_t* outdata = e.m_hdr + ethernet::HEADER_LEN + ipv4::HEADER_LEN;
+  /*
+   * Write the Ethernet and IPv4 headers.
+   */
+  m_ipv4to.header(e.m_rethaddr, e.m_ripaddr, ipv4::PROTO_TCP, e.m_hdr);
+  /*
+   * Write the fields of the TCP header that do not change.
+   */
+  memset(outdata, 0, HEADER_LEN);
+  OUTTCP->srcport = e.m_lport;
+  OUTTCP->destport = e.m_rport;
+  OUTTCP->offset = 5;
+  /*
+   * Sum the pseudo-header, but for the TCP length.
+   */
+  e.m_hdrsum = pseudoHeader(m_ipv4to.hostAddress(), e.m_ripaddr);
+}
+
+void
+Processor::writeTimestamps(Connection const& e, uint8_t* const opts) const
+{
+  uint32_t tsval = htonl(timestamp());
+  uint32_t tsecr = htonl(e.m_tsrecent);
+  opts[0] = Options::NOOP;
+  opts[1] = Options::NOOP;
+  opts[2] = Options::TSO;
+  opts[3] = Options::TSO_LEN;
+  memcpy(&opts[4], &tsval, sizeof(tsval));
+  memcpy(&opts[8], &tsecr, sizeof(tsecr));
 }
 
 Status
-Processor::send(ipv4::Address const& UNUSED dst, const uint32_t len,
+Processor::send(const uint16_t UNUSED seed, const uint32_t len,
                 const uint16_t mss, uint8_t* const outdata)
 {
   /*
@@ -285,7 +510,7 @@ Processor::send(ipv4::Address const& UNUSED dst, const uint32_t len,
    * Calculate TCP checksum.
    */
 #ifndef TULIPS_HAS_HW_CHECKSUM
-  uint16_t csum = checksum(m_ipv4to.hostAddress(), dst, len, outdata);
+  uint16_t csum = checksum(seed, len, outdata);
   OUTTCP->chksum = ~csum;
 #endif
   /*
@@ -294,6 +519,43 @@ Processor::send(ipv4::Address const& UNUSED dst, const uint32_t len,
   return m_ipv4to.commit(len, outdata, mss);
 }
 
+Status
+Processor::sendSegment(Connection const& e, const uint32_t len, Segment& s)
+{
+  uint8_t* outdata = s.m_dat;
+  const uint16_t hlen = OUTTCP->offset << 2;
+  const uint16_t plen = len - hlen;
+  /*
+   * Reset URG and checksum fields
+   */
+  OUTTCP->urgp = 0;
+  OUTTCP->chksum = 0;
+  OUTTCP->reserved = 0;
+  /*
+   * Calculate TCP checksum. The payload does not change once sent, so its sum
+   * is kept in the segment and only the header is summed when retransmitting
+   * or updating the acknowledgement of the segment (RFC 1071).
+   */
+#ifndef TULIPS_HAS_HW_CHECKSUM
+  if (plen > 0 && !s.m_summed) {
+    s.m_sum = utils::checksum(0, payload(s), plen);
+    s.m_summed = true;
+  }
+  const uint16_t psum = plen > 0 ? s.m_sum : 0;
+  uint16_t csum = checksum(e.m_hdrsum, hlen, outdata, plen, psum);
+  OUTTCP->chksum = ~csum;
+#endif
+  /*
+   * Actually send. The data referenced by the segment is sent as a separate
+   * fragment.
+   */
+  if (unlikely(s.m_zcopy)) {
+    transport::Frame frag = { plen, payload(s) };
+    return m_ipv4to.commitv(hlen, outdata, 1, &frag, e.m_mss);
+  }
+  return m_ipv4to.commit(len, outdata, e.m_mss);
+}
+
 Status
 Processor::rexmit(Connection& e)
 {
@@ -334,11 +596,7 @@ Processor::rexmit(Connection& e)
      * out the packet (the apprexmit label).
      */
     case Connection::ESTABLISHED: {
-      TCP_LOG("retransmit PSH");
-      Segment& seg = e.segment();
-      seg.swap(e.m_sdat);
-      e.resetSendBuffer();
-      return send(e, seg, TCP_PSH);
+      return rexmit(e, e.segment());
     }
     /*
      * In all these states we should retransmit a FINACK.
@@ -369,4 +627,60 @@ Processor::rexmit(Connection& e)
   return Status::Ok;
 }
 
+Status
+Processor::rexmit(Connection& e, Segment& seg)
+{
+  TCP_LOG("retransmit PSH seq:" << seg.m_seq);
+  /*
+   * Data may be pending in the send buffer. In that case, we should not erase
+   * that data and use a new buffer.
+   */
+  if (unlikely(e.hasPendingSendData())) {
+    uint8_t* buf;
+    Status ret = prepare(e, buf);
+    if (ret != Status::Ok) {
+      TCP_LOG("prepare() for rexmit() failed");
+      return ret;
+    }
+    seg.swap(buf);
+    return send(e, seg, TCP_PSH);
+  }
+  seg.swap(e.m_sdat);
+  e.resetSendBuffer();
+  return send(e, seg, TCP_PSH);
+}
+
+Status
+Processor::rexmitLost(Connection& e)
+{
+  size_t last = 0;
+  /*
+   * Find the last segment that was selectively acknowledged. Segments are
+   * stored in sequence order starting from the oldest one.
+   */
+  for (size_t i = 0; i < e.m_segcnt; i += 1) {
+    if (e.segment(i).m_sacked) {
+      last = i;
+    }
+  }
+  /*
+   * The holes before that segment are considered lost. Without SACK
+   * information, only the oldest segment is (RFC 6582). Retransmit the lost
+   * segments that have not been retransmitted yet during this recovery.
+   */
+  for (size_t i = 0; i <= last; i += 1) {
+    Segment& seg = e.segment(i);
+    if (seg.m_sacked || seg.m_rexmit) {
+      continue;
+    }
+    m_stats.rexmit += 1;
+    seg.m_rexmit = true;
+    Status ret = rexmit(e, seg);
+    if (ret != Status::Ok) {
+      return ret;
+    }
+  }
+  return Status::Ok;
+}
+
 }}}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tulips/stack/tcpv4/SynCookie.h>
+#include <random>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+/*
+ * Cookie layout.
+ */
+static constexpr uint32_t HASH_BITS = 21;
+static constexpr uint32_t HASH_MASK = (1UL << HASH_BITS) - 1;
+static constexpr uint32_t COUNTER_MASK = 0x7;
+
+/*
+ * MSS values that can be encoded in a cookie, in increasing order.
+ */
+static constexpr uint16_t MSS_TABLE[8] = { 536,  1220, 1360, 1400,
+                                           1440, 1460, 4036, 8960 };
+
+/*
+ * Finalizer of splitmix64, used to mix the keyed hash input.
+ */
+static inline uint64_t
+mix(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static inline uint32_t
+counter(const system::Clock::Value now)
+{
+  return (now / (SynCookie::PERIOD * CLOCK_SECOND)) & COUNTER_MASK;
+}
+
+constexpr uint32_t SynCookie::PERIOD;
+
+SynCookie::SynCookie() : m_secret()
+{
+  std::random_device rd;
+  m_secret[0] = (uint64_t)rd() << 32 | rd();
+  m_secret[1] = (uint64_t)rd() << 32 | rd();
+}
+
+uint32_t
+SynCookie::make(ipv4::Address const& ripaddr, const Port rport,
+                const Port lport, const uint32_t seqno, State const& st,
+                const system::Clock::Value now) const
+{
+  /*
+   * Round the MSS down to the closest value of the table.
+   */
+  uint32_t idx = 0;
+  while (idx < 7 && MSS_TABLE[idx + 1] <= st.mss) {
+    idx += 1;
+  }
+  /*
+   * Encode the state, then sign it.
+   */
+  uint32_t wsc = !st.wscok ? 15 : st.wsc > 14 ? 14 : st.wsc;
+  uint32_t bits = counter(now) << 8 | idx << 5 | wsc << 1 | st.sackperm;
+  return bits << HASH_BITS | hash(ripaddr, rport, lport, seqno, bits);
+}
+
+bool
+SynCookie::check(ipv4::Address const& ripaddr, const Port rport,
+                 const Port lport, const uint32_t seqno, const uint32_t cookie,
+                 const system::Clock::Value now, State& st) const
+{
+  uint32_t bits = cookie >> HASH_BITS;
+  /*
+   * Check the age of the cookie, then its signature.
+   */
+  if (((counter(now) - (bits >> 8)) & COUNTER_MASK) > 1) {
+    return false;
+  }
+  if ((cookie & HASH_MASK) != hash(ripaddr, rport, lport, seqno, bits)) {
+    return false;
+  }
+  /*
+   * Decode the state.
+   */
+  st.mss = MSS_TABLE[(bits >> 5) & 0x7];
+  st.wsc = (bits >> 1) & 0xF;
+  st.wscok = st.wsc != 15;
+  st.wsc = st.wscok ? st.wsc : 0;
+  st.sackperm = bits & 0x1;
+  return true;
+}
+
+uint32_t
+SynCookie::hash(ipv4::Address const& ripaddr, const Port rport,
+                const Port lport, const uint32_t seqno,
+                const uint32_t bits) const
+{
+  uint64_t key =
+    (uint64_t)*ripaddr.data() << 32 | (uint64_t)rport << 16 | lport;
+  uint64_t h = mix(m_secret[0] ^ key);
+  h = mix(h ^ m_secret[1] ^ ((uint64_t)seqno << 32 | bits));
+  return h & HASH_MASK;
+}
+
+}}}
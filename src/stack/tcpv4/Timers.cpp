@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Timers.h>
+
+namespace tulips { namespace stack { namespace tcpv4 {
+
+constexpr uint32_t Timers::NPOS;
+
+Timers::Timers(const size_t nconn)
+  : m_deadline(nconn * COUNT, 0), m_position(nconn * COUNT, NPOS), m_heap()
+{
+  m_heap.reserve(nconn * COUNT);
+}
+
+void
+Timers::arm(const Connection::ID id, const Kind kind,
+            const system::Clock::Value deadline)
+{
+  const uint32_t tid = id * COUNT + kind;
+  const uint32_t pos = m_position[tid];
+  m_deadline[tid] = deadline;
+  /*
+   * The timer is not in the heap, push it.
+   */
+  if (pos == NPOS) {
+    m_position[tid] = m_heap.size();
+    m_heap.push_back({ deadline, tid });
+    up(m_heap.size() - 1);
+  }
+  /*
+   * The timer is in the heap and expires earlier, move it up. If it expires
+   * later, the entry is updated when it reaches the top.
+   */
+  else if (deadline < m_heap[pos].m_when) {
+    m_heap[pos].m_when = deadline;
+    up(pos);
+  }
+}
+
+bool
+Timers::expired(const system::Clock::Value now, Connection::ID& id,
+                Kind& kind)
+{
+  while (!m_heap.empty() && m_heap[0].m_when <= now) {
+    const uint32_t tid = m_heap[0].m_tid;
+    const system::Clock::Value deadline = m_deadline[tid];
+    /*
+     * The timer has been disarmed, drop the entry.
+     */
+    if (deadline == 0) {
+      pop();
+      continue;
+    }
+    /*
+     * The timer has been pushed back, update the entry.
+     */
+    if (deadline > now) {
+      m_heap[0].m_when = deadline;
+      down(0);
+      continue;
+    }
+    /*
+     * The timer has expired.
+     */
+    pop();
+    m_deadline[tid] = 0;
+    id = tid / COUNT;
+    kind = Kind(tid % COUNT);
+    return true;
+  }
+  return false;
+}
+
+void
+Timers::up(uint32_t pos)
+{
+  const Entry entry = m_heap[pos];
+  while (pos > 0) {
+    const uint32_t parent = (pos - 1) >> 1;
+    if (m_heap[parent].m_when <= entry.m_when) {
+      break;
+    }
+    m_heap[pos] = m_heap[parent];
+    m_position[m_heap[pos].m_tid] = pos;
+    pos = parent;
+  }
+  m_heap[pos] = entry;
+  m_position[entry.m_tid] = pos;
+}
+
+void
+Timers::down(uint32_t pos)
+{
+  const Entry entry = m_heap[pos];
+  const uint32_t size = m_heap.size();
+  for (;;) {
+    uint32_t child = (pos << 1) + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && m_heap[child + 1].m_when < m_heap[child].m_when) {
+      child += 1;
+    }
+    if (entry.m_when <= m_heap[child].m_when) {
+      break;
+    }
+    m_heap[pos] = m_heap[child];
+    m_position[m_heap[pos].m_tid] = pos;
+    pos = child;
+  }
+  m_heap[pos] = entry;
+  m_position[entry.m_tid] = pos;
+}
+
+void
+Timers::pop()
+{
+  m_position[m_heap[0].m_tid] = NPOS;
+  m_heap[0] = m_heap.back();
+  m_heap.pop_back();
+  if (!m_heap.empty()) {
+    down(0);
+  }
+}
+
+}}}
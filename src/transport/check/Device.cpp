@@ -61,6 +61,17 @@ Device::process(const uint16_t len, const uint8_t* const data)
   return m_proc->process(len, data);
 }
 
+Status
+Device::process(const uint16_t count, const Frame* const frames)
+{
+  for (uint16_t i = 0; i < count; i += 1) {
+    if (!check(frames[i].data, frames[i].len)) {
+      throw std::runtime_error("Empty packet has been received !");
+    }
+  }
+  return m_proc->process(count, frames);
+}
+
 Status
 Device::prepare(uint8_t*& buf)
 {
@@ -78,6 +89,20 @@ Device::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
   return m_device.commit(len, buf, mss);
 }
 
+Status
+Device::commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                const Frame* const frags, const uint16_t mss)
+{
+  bool valid = check(m_buffer, len);
+  for (uint16_t i = 0; i < count && !valid; i += 1) {
+    valid = check(frags[i].data, frags[i].len);
+  }
+  if (!valid) {
+    throw std::runtime_error("Empty packet has been received !");
+  }
+  return m_device.commitv(len, buf, count, frags, mss);
+}
+
 bool
 Device::check(const uint8_t* const data, const size_t len)
 {
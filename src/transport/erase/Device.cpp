@@ -63,4 +63,11 @@ Device::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
   return m_device.commit(len, buf, mss);
 }
 
+Status
+Device::commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                const Frame* const frags, const uint16_t mss)
+{
+  return m_device.commitv(len, buf, count, frags, mss);
+}
+
 }}}
@@ -87,6 +87,7 @@ Device::Device(const uint16_t nbuf)
   , m_bcast(nullptr)
   , m_flow(nullptr)
   , m_filters()
+  , m_regions()
 {
   std::string ifn;
   /*
@@ -129,6 +130,7 @@ Device::Device(std::string const& ifn, const uint16_t nbuf)
   , m_bcast(nullptr)
   , m_flow(nullptr)
   , m_filters()
+  , m_regions()
 {
   /*
    * Check if the interface driver is mlx?_core.
@@ -419,6 +421,10 @@ Device::~Device()
    * Destroy memory regions
    */
   tulips_fifo_destroy(&m_fifo);
+  for (auto& region : m_regions) {
+    ibv_dereg_mr(region.second);
+  }
+  m_regions.clear();
   if (m_sendmr) {
     ibv_dereg_mr(m_sendmr);
   }
@@ -540,9 +546,10 @@ Device::poll(Processor& proc)
   }
   OFED_LOG(cqn << " buffers available");
   /*
-   * Process the buffers.
+   * Gather the valid buffers.
    */
-  int pre = 0;
+  Frame frames[m_nbuf];
+  uint16_t count = 0;
   m_pending = cqn;
   for (int i = 0; i < cqn; i += 1) {
     int id = wc[i].wr_id;
@@ -572,30 +579,18 @@ Device::poll(Processor& proc)
       }
     }
 #endif
-    /*
-     * Process the packet.
-     */
-    proc.process(len, addr);
-    /*
-     * Re-post the buffers every 10 WCs.
-     */
-    if (i > 0 && i % POST_RECV_THRESHOLD == 0) {
-      for (int j = pre; j < pre + POST_RECV_THRESHOLD; j += 1) {
-        const int lid = wc[j].wr_id;
-        Status res = postReceive(lid);
-        if (res != Status::Ok) {
-          LOG("OFDED", "re-post receive of buffer id=" << lid << "failed");
-          return Status::HardwareError;
-        }
-      }
-      pre += POST_RECV_THRESHOLD;
-      m_pending -= POST_RECV_THRESHOLD;
-    }
+    frames[count].len = len;
+    frames[count].data = addr;
+    count += 1;
   }
   /*
-   * Prepare the received buffers for repost.
+   * Process the buffers as one burst.
+   */
+  proc.process(count, frames);
+  /*
+   * Re-post the buffers.
    */
-  for (int i = pre; i < cqn; i += 1) {
+  for (int i = 0; i < cqn; i += 1) {
     const int id = wc[i].wr_id;
     Status res = postReceive(id);
     if (res != Status::Ok) {
@@ -794,4 +789,121 @@ Device::commit(const uint32_t len, uint8_t* const buf,
   return Status::Ok;
 }
 
+Status
+Device::commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                const Frame* const frags, const uint16_t mss)
+{
+  struct ibv_sge sges[MAX_SEND_SGE];
+  uint32_t total = len;
+  /*
+   * Copy the fragments in the buffer if they do not fit in the work request.
+   */
+  if (count >= MAX_SEND_SGE) {
+    return transport::Device::commitv(len, buf, count, frags, mss);
+  }
+  /*
+   * Prepare the SGEs: the headers from the send buffer, then the fragments.
+   * Copy the fragments if any of them is not in registered memory.
+   */
+  sges[0].addr = (uint64_t)buf;
+  sges[0].length = len;
+  sges[0].lkey = m_sendmr->lkey;
+  for (uint16_t i = 0; i < count; i += 1) {
+    ibv_mr* mr = lookup(frags[i].data, frags[i].len);
+    if (mr == nullptr) {
+      return transport::Device::commitv(len, buf, count, frags, mss);
+    }
+    sges[i + 1].addr = (uint64_t)frags[i].data;
+    sges[i + 1].length = frags[i].len;
+    sges[i + 1].lkey = mr->lkey;
+    total += frags[i].len;
+  }
+  /*
+   * Prepare the WR.
+   */
+  struct ibv_exp_send_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = (uint64_t)buf;
+#ifdef TULIPS_HAS_HW_TSO
+  /*
+   * The headers are given to the NIC separately, it segments the fragments.
+   */
+  uint16_t lmss = mss;
+  if (mss == 0 || mss > m_hwmtu - len) {
+    lmss = m_hwmtu + stack::ethernet::HEADER_LEN - len;
+    OFED_LOG("adjusting request MSS from " << mss << " to " << lmss);
+  }
+  wr.sg_list = &sges[1];
+  wr.num_sge = count;
+  wr.tso.mss = lmss;
+  wr.tso.hdr = buf;
+  wr.tso.hdr_sz = len;
+  wr.exp_opcode = IBV_EXP_WR_TSO;
+#else
+  wr.sg_list = sges;
+  wr.num_sge = count + 1;
+  wr.exp_opcode = IBV_EXP_WR_SEND;
+#endif
+  wr.exp_send_flags = IBV_EXP_SEND_SIGNALED | IBV_EXP_SEND_IP_CSUM;
+  /*
+   * Mark the transaction inline.
+   */
+  wr.exp_send_flags |= total <= INLINE_DATA_THRESHOLD ? IBV_SEND_INLINE : 0;
+  /*
+   * Post the work request.
+   */
+  struct ibv_exp_send_wr* bad_wr;
+  if (ibv_exp_post_send(m_qp, &wr, &bad_wr) != 0) {
+    LOG("OFED", "post send of buffer len=" << total << " with " << count
+                                           << " fragments failed, "
+                                           << strerror(errno));
+    return Status::HardwareError;
+  }
+  OFED_LOG("commit buffer " << (void*)buf << " len " << total << " with "
+                            << count << " fragments");
+  return Status::Ok;
+}
+
+Status
+Device::registerMemory(const void* const addr, const size_t len)
+{
+  ibv_mr* mr = ibv_reg_mr(m_pd, (void*)addr, len, IBV_ACCESS_LOCAL_WRITE);
+  if (mr == nullptr) {
+    LOG("OFED", "cannot register memory region, " << strerror(errno));
+    return Status::HardwareError;
+  }
+  m_regions[(uintptr_t)addr] = mr;
+  return Status::Ok;
+}
+
+Status
+Device::unregisterMemory(const void* const addr)
+{
+  auto it = m_regions.find((uintptr_t)addr);
+  if (it == m_regions.end()) {
+    return Status::InvalidArgument;
+  }
+  ibv_dereg_mr(it->second);
+  m_regions.erase(it);
+  return Status::Ok;
+}
+
+ibv_mr*
+Device::lookup(const uint8_t* const data, const size_t len) const
+{
+  /*
+   * Find the last region that starts before the data.
+   */
+  auto it = m_regions.upper_bound((uintptr_t)data);
+  if (it == m_regions.begin()) {
+    return nullptr;
+  }
+  --it;
+  /*
+   * Check that the data fits in that region.
+   */
+  uintptr_t end = it->first + it->second->length;
+  return (uintptr_t)data + len <= end ? it->second : nullptr;
+}
+
 }}}
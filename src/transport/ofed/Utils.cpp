@@ -199,7 +199,8 @@ setup(ibv_context* context, ibv_pd* pd, const uint8_t port, const uint16_t nbuf,
    */
   qp_init_attr.cap.max_send_wr = nbuf;
   qp_init_attr.cap.max_recv_wr = nbuf;
-  qp_init_attr.cap.max_send_sge = 1;
+  qp_init_attr.cap.max_send_sge =
+    tulips::transport::ofed::Device::MAX_SEND_SGE;
   qp_init_attr.cap.max_recv_sge = 1;
   qp_init_attr.cap.max_inline_data =
     tulips::transport::ofed::Device::INLINE_DATA_THRESHOLD;
@@ -77,6 +77,7 @@ Device::Device(transport::Device& device, std::string const& fn)
   , m_pcap(nullptr)
   , m_pcap_dumper(nullptr)
   , m_proc(nullptr)
+  , m_gather()
 {
   /*
    * We adapt the snapshot length to the lower link MSS. With TSO enabled, the
@@ -131,6 +132,25 @@ Device::commit(const uint32_t len, uint8_t* const buf, const uint16_t mss)
   return ret;
 }
 
+Status
+Device::commitv(const uint32_t len, uint8_t* const buf, const uint16_t count,
+                const Frame* const frags, const uint16_t mss)
+{
+  Status ret = m_device.commitv(len, buf, count, frags, mss);
+  if (ret == Status::Ok) {
+    /*
+     * Gather the headers and the fragments to write the packet.
+     */
+    m_gather.assign(buf, buf + len);
+    for (uint16_t i = 0; i < count; i += 1) {
+      m_gather.insert(m_gather.end(), frags[i].data,
+                      frags[i].data + frags[i].len);
+    }
+    writePacket(m_pcap_dumper, m_gather.data(), m_gather.size());
+  }
+  return ret;
+}
+
 Status
 Device::process(const uint16_t len, const uint8_t* const data)
 {
@@ -140,4 +160,15 @@ Device::process(const uint16_t len, const uint8_t* const data)
   return m_proc->process(len, data);
 }
 
+Status
+Device::process(const uint16_t count, const Frame* const frames)
+{
+  for (uint16_t i = 0; i < count; i += 1) {
+    if (frames[i].len > 0) {
+      writePacket(m_pcap_dumper, frames[i].data, frames[i].len);
+    }
+  }
+  return m_proc->process(count, frames);
+}
+
 }}}
@@ -91,17 +91,7 @@ Device::poll(Processor& proc)
   /*
    * Process the data
    */
-  Packet* packet = nullptr;
-  if (tulips_fifo_front(read_fifo, (void**)&packet) != TULIPS_FIFO_OK) {
-    return Status::HardwareError;
-  }
-  SHM_LOG("processing packet: " << packet->len << "B, " << packet);
-#if SHM_VERBOSE && SHM_HEXDUMP
-  stack::utils::hexdump(packet->data, packet->len, std::cout);
-#endif
-  Status ret = proc.process(packet->len, packet->data);
-  tulips_fifo_pop(read_fifo);
-  return ret;
+  return process(proc);
 }
 
 Status
@@ -126,14 +116,7 @@ Device::wait(Processor& proc, const uint64_t ns)
   /*
    * Process the data
    */
-  Packet* packet = nullptr;
-  if (tulips_fifo_front(read_fifo, (void**)&packet) != TULIPS_FIFO_OK) {
-    return Status::HardwareError;
-  }
-  SHM_LOG("processing packet: " << packet->len << "B, " << packet);
-  Status ret = proc.process(packet->len, packet->data);
-  tulips_fifo_pop(read_fifo);
-  return ret;
+  return process(proc);
 }
 
 Status
@@ -174,6 +157,51 @@ Device::drop()
   return Status::Ok;
 }
 
+Status
+Device::process(Processor& proc)
+{
+  Packet* packet = nullptr;
+  /*
+   * Process one packet at a time, unless asked to process them in bursts.
+   */
+  if (!(m_hints & RECEIVE_BURST)) {
+    if (tulips_fifo_front(read_fifo, (void**)&packet) != TULIPS_FIFO_OK) {
+      return Status::HardwareError;
+    }
+    SHM_LOG("processing packet: " << packet->len << "B, " << packet);
+#if SHM_VERBOSE && SHM_HEXDUMP
+    stack::utils::hexdump(packet->data, packet->len, std::cout);
+#endif
+    Status ret = proc.process(packet->len, packet->data);
+    tulips_fifo_pop(read_fifo);
+    return ret;
+  }
+  /*
+   * Gather the pending packets, in place.
+   */
+  Frame frames[BURST_SIZE];
+  uint16_t count = 0;
+  while (count < BURST_SIZE &&
+         tulips_fifo_peek(read_fifo, count, (void**)&packet) ==
+           TULIPS_FIFO_OK) {
+    SHM_LOG("processing packet: " << packet->len << "B, " << packet);
+    frames[count].len = packet->len;
+    frames[count].data = packet->data;
+    count += 1;
+  }
+  if (count == 0) {
+    return Status::HardwareError;
+  }
+  /*
+   * Process the burst, then release the packets.
+   */
+  Status ret = proc.process(count, frames);
+  for (uint16_t i = 0; i < count; i += 1) {
+    tulips_fifo_pop(read_fifo);
+  }
+  return ret;
+}
+
 /*
  * This implementation is very expensive...
  */
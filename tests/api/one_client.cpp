@@ -40,18 +40,69 @@ using namespace stack;
 
 namespace {
 
+class ClientDelegate : public defaults::ClientDelegate
+{
+public:
+  using defaults::ClientDelegate::onNewData;
+
+  ClientDelegate() : m_opts(0), m_deliveries(0), m_fragments(0) {}
+
+  void* onConnected(UNUSED Client::ID const& id, UNUSED void* const cookie,
+                    uint16_t& opts) override
+  {
+    opts = m_opts;
+    return nullptr;
+  }
+
+  Action onNewData(UNUSED Client::ID const& id, UNUSED void* const cookie,
+                   UNUSED const uint8_t* const data, UNUSED const uint32_t len,
+                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
+                   UNUSED uint32_t& slen) override
+  {
+    m_deliveries += 1;
+    m_fragments += 1;
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED Client::ID const& id, UNUSED void* const cookie,
+                   UNUSED const transport::Frame* const frags,
+                   const size_t count, UNUSED const uint32_t alen,
+                   UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    m_deliveries += 1;
+    m_fragments += count;
+    return Action::Continue;
+  }
+
+  void setCoalesce() { m_opts |= tcpv4::Connection::COALESCE; }
+
+  size_t deliveryCount() const { return m_deliveries; }
+
+  size_t fragmentCount() const { return m_fragments; }
+
+private:
+  uint16_t m_opts;
+  size_t m_deliveries;
+  size_t m_fragments;
+};
+
 class ServerDelegate : public defaults::ServerDelegate
 {
 public:
-  ServerDelegate() : m_listenCookie(0), m_action(Action::Continue), m_opts(0) {}
+  using defaults::ServerDelegate::onNewData;
+
+  ServerDelegate()
+    : m_listenCookie(0), m_action(Action::Continue), m_opts(0), m_id(0)
+  {}
 
-  void* onConnected(UNUSED Server::ID const& id, void* const cookie,
-                    uint8_t& opts) override
+  void* onConnected(Server::ID const& id, void* const cookie,
+                    uint16_t& opts) override
   {
     if (cookie != nullptr) {
       m_listenCookie = *reinterpret_cast<size_t*>(cookie);
     }
     opts = m_opts;
+    m_id = id;
     return nullptr;
   }
 
@@ -71,10 +122,15 @@ public:
 
   void setDelayedACK() { m_opts |= tcpv4::Connection::DELAYED_ACK; }
 
+  void setNoDelay() { m_opts |= tcpv4::Connection::NO_DELAY; }
+
+  Server::ID id() const { return m_id; }
+
 private:
   size_t m_listenCookie;
   Action m_action;
   uint8_t m_opts;
+  Server::ID m_id;
 };
 
 } // namespace
@@ -180,7 +236,7 @@ protected:
   transport::list::Device* m_server_ldev;
   transport::pcap::Device* m_client_pcap;
   transport::pcap::Device* m_server_pcap;
-  defaults::ClientDelegate m_client_delegate;
+  ClientDelegate m_client_delegate;
   Client* m_client;
   ServerDelegate m_server_delegate;
   Server* m_server;
@@ -540,3 +596,58 @@ TEST_F(API_OneClient, ListenConnectSendAndAbortFromServerWithDelayedACK)
   ASSERT_EQ(Status::NoDataAvailable, m_server_pcap->poll(*m_server));
   ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client));
 }
+
+TEST_F(API_OneClient, ListenConnectAndReceiveCoalesced)
+{
+  Client::ID id = Client::DEFAULT_ID;
+  ipv4::Address dst_ip(10, 1, 0, 2);
+  /*
+   * Server listens, client coalesces.
+   */
+  m_server_delegate.setNoDelay();
+  m_server->listen(12345, nullptr);
+  m_client_delegate.setCoalesce();
+  /*
+   * Client opens a connection.
+   */
+  ASSERT_EQ(Status::Ok, m_client->open(id));
+  /*
+   * Client connects.
+   */
+  ASSERT_EQ(Status::OperationInProgress, m_client->connect(id, dst_ip, 12345));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client));
+  ASSERT_EQ(Status::OperationInProgress, m_client->connect(id, dst_ip, 12345));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server));
+  ASSERT_EQ(Status::Ok, m_client->connect(id, dst_ip, 12345));
+  /*
+   * Server sends three segments.
+   */
+  uint64_t data = 0xdeadbeef;
+  for (size_t i = 0; i < 3; i += 1) {
+    uint32_t rem = 0;
+    ASSERT_EQ(Status::Ok, m_server->send(m_server_delegate.id(), sizeof(data),
+                                         (const uint8_t*)&data, rem));
+  }
+  ASSERT_EQ(3, m_server_list.size());
+  /*
+   * Client processes them as one burst. The delegate is called once with all
+   * the fragments.
+   */
+  transport::Frame frames[3];
+  size_t count = 0;
+  for (auto* p : m_server_list) {
+    frames[count].len = p->len;
+    frames[count].data = p->data;
+    count += 1;
+  }
+  ASSERT_EQ(Status::Ok, m_client->process(count, frames));
+  for (auto* p : m_server_list) {
+    transport::list::Device::Packet::release(p);
+  }
+  m_server_list.clear();
+  ASSERT_EQ(1, m_client_delegate.deliveryCount());
+  ASSERT_EQ(3, m_client_delegate.fragmentCount());
+}
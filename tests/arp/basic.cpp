@@ -48,6 +48,8 @@ public:
 
   Status run() override { return Status::Ok; }
 
+  using transport::Processor::process;
+
   Status process(const uint16_t UNUSED len, const uint8_t* const data) override
   {
     m_data = *(uint64_t*)data;
@@ -67,6 +69,8 @@ public:
 
   Status run() override { return Status::Ok; }
 
+  using transport::Processor::process;
+
   Status process(const uint16_t UNUSED len, const uint8_t* const data) override
   {
     m_data = *(uint64_t*)data;
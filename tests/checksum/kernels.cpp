@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tulips/stack/Utils.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace tulips;
+using namespace stack;
+
+namespace {
+
+constexpr size_t MAXLEN = 65535;
+
+/*
+ * Check all the kernels against the reference, on a buffer at all alignments.
+ */
+void
+check(std::vector<utils::ChecksumKernel> const& kernels, const uint8_t* data,
+      const uint16_t len, const uint16_t seed)
+{
+  auto ref = kernels.front().function;
+  for (size_t off = 0; off < 8 && off <= len; off += 1) {
+    uint16_t exp = ref(seed, data + off, len - off);
+    for (auto const& k : kernels) {
+      ASSERT_EQ(exp, k.function(seed, data + off, len - off))
+        << k.name << " len:" << len - off << " seed:" << seed;
+    }
+  }
+}
+
+} // namespace
+
+TEST(Checksum_Kernels, MatchReference)
+{
+  std::mt19937 rng(1);
+  std::vector<uint8_t> data(MAXLEN);
+  auto kernels = utils::checksumKernels();
+  ASSERT_EQ("scalar", std::string(kernels.front().name));
+  /*
+   * Random data, for all lengths around the vector sizes and a few large ones.
+   */
+  for (auto& b : data) {
+    b = rng();
+  }
+  for (uint16_t len = 0; len < 300; len += 1) {
+    check(kernels, data.data(), len, rng());
+  }
+  for (uint16_t len : { 1460, 1500, 4096, 9000, 32768, 65535 }) {
+    check(kernels, data.data(), len, 0);
+    check(kernels, data.data(), len, rng());
+  }
+  /*
+   * Data that carries the most.
+   */
+  std::fill(data.begin(), data.end(), 0xFF);
+  check(kernels, data.data(), MAXLEN, 0);
+  check(kernels, data.data(), MAXLEN, 0xFFFF);
+  /*
+   * Null data.
+   */
+  std::fill(data.begin(), data.end(), 0);
+  check(kernels, data.data(), MAXLEN, 0);
+  check(kernels, data.data(), 64, 0xFFFF);
+  /*
+   * The dispatched kernel agrees with the reference.
+   */
+  data[3] = 0x42;
+  auto ref = kernels.front().function;
+  ASSERT_EQ(ref(0x1234, data.data(), 128),
+            utils::checksum(0x1234, data.data(), 128));
+}
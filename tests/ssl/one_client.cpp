@@ -43,6 +43,8 @@ namespace {
 class ServerDelegate : public defaults::ServerDelegate
 {
 public:
+  using defaults::ServerDelegate::onNewData;
+
   ServerDelegate() : m_action(Action::Continue) {}
 
   tulips::Action onNewData(UNUSED Client::ID const& id,
@@ -42,6 +42,8 @@ namespace {
 class ClientDelegate : public defaults::ClientDelegate
 {
 public:
+  using defaults::ClientDelegate::onNewData;
+
   ClientDelegate() : m_data_received(false) {}
 
   tulips::Action onNewData(UNUSED Client::ID const& id,
@@ -74,12 +76,14 @@ private:
 class ServerDelegate : public defaults::ServerDelegate
 {
 public:
+  using defaults::ServerDelegate::onNewData;
+
   using Connections = std::list<tulips::Server::ID>;
 
   ServerDelegate() : m_connections(), m_send_back(false) {}
 
   void* onConnected(Server::ID const& id, UNUSED void* const cookie,
-                    UNUSED uint8_t& opts) override
+                    UNUSED uint16_t& opts) override
   {
     m_connections.push_back(id);
     return nullptr;
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Processor.h>
+#include <tulips/stack/ipv4/Producer.h>
+#include <tulips/stack/ipv4/Processor.h>
+#include <tulips/stack/ethernet/Producer.h>
+#include <tulips/stack/ethernet/Processor.h>
+#include <tulips/system/Compiler.h>
+#include <tulips/transport/list/Device.h>
+#include <gtest/gtest.h>
+
+using namespace tulips;
+using namespace stack;
+
+namespace {
+
+class Handler : public tcpv4::EventHandler
+{
+public:
+  using tcpv4::EventHandler::onNewData;
+
+  Handler() : connected(0), received(0) {}
+
+  void onConnected(UNUSED tcpv4::Connection& c) override { connected += 1; }
+
+  void onAborted(UNUSED tcpv4::Connection& c) override {}
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override {}
+
+  void onSent(UNUSED tcpv4::Connection& c) override {}
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   const uint32_t len) override
+  {
+    received += len;
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data, const uint32_t len,
+                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
+                   UNUSED uint32_t& slen) override
+  {
+    received += len;
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override {}
+
+  size_t connected;
+  size_t received;
+};
+
+/*
+ * A complete Ethernet/IPv4/TCPv4 stack on top of a device.
+ */
+struct Stack
+{
+  Stack(transport::Device& dev, ipv4::Address const& ip4,
+        ipv4::Address const& bcast, ipv4::Address const& nmask,
+        const size_t nconn)
+    : evt()
+    , eth_prod(dev, dev.address())
+    , ip4_prod(eth_prod, ip4)
+    , eth_proc(dev.address())
+    , ip4_proc(ip4)
+    , tcp(dev, eth_prod, ip4_prod, evt, nconn)
+  {
+    tcp.setEthernetProcessor(eth_proc).setIPv4Processor(ip4_proc);
+    ip4_prod.setDefaultRouterAddress(bcast).setNetMask(nmask);
+    ip4_proc.setEthernetProcessor(eth_proc).setTCPv4Processor(tcp);
+    eth_proc.setIPv4Processor(ip4_proc);
+  }
+
+  Handler evt;
+  ethernet::Producer eth_prod;
+  ipv4::Producer ip4_prod;
+  ethernet::Processor eth_proc;
+  ipv4::Processor ip4_proc;
+  tcpv4::Processor tcp;
+};
+
+} // namespace
+
+class TCP_Accept : public ::testing::Test
+{
+public:
+  TCP_Accept()
+    : m_client_adr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10)
+    , m_server_adr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20)
+    , m_bcast(10, 1, 0, 254)
+    , m_nmask(255, 255, 255, 0)
+    , m_client_ip4(10, 1, 0, 1)
+    , m_server_ip4(10, 1, 0, 2)
+  {}
+
+protected:
+  /*
+   * Fill a server with nconn half-open connections.
+   */
+  void fill(const size_t nconn)
+  {
+    transport::list::Device::List client_list;
+    transport::list::Device::List server_list;
+    /*
+     * Build the devices and the stacks.
+     */
+    transport::list::Device client(m_client_adr, m_client_ip4, m_bcast,
+                                   m_nmask, 1514, server_list, client_list);
+    transport::list::Device server(m_server_adr, m_server_ip4, m_bcast,
+                                   m_nmask, 1514, client_list, server_list);
+    Stack cstack(client, m_client_ip4, m_bcast, m_nmask, nconn);
+    Stack sstack(server, m_server_ip4, m_bcast, m_nmask, nconn);
+    sstack.tcp.listen(1234);
+    /*
+     * Open the connections. The SYN/ACKs are dropped so that the server-side
+     * connections all stay in SYN_RCVD.
+     */
+    for (size_t i = 0; i < nconn; i += 1) {
+      tcpv4::Connection::ID c;
+      EXPECT_EQ(Status::Ok,
+                cstack.tcp.connect(m_server_adr, m_server_ip4, 1234, c));
+      EXPECT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+      EXPECT_EQ(1, server_list.size());
+      client.drop();
+    }
+    /*
+     * The table is full, any new SYN is dropped.
+     */
+    tcpv4::Connection::ID c;
+    EXPECT_EQ(Status::NoMoreResources,
+              cstack.tcp.connect(m_server_adr, m_server_ip4, 1234, c));
+  }
+
+  /*
+   * Flood a server of nconn connections with nsyn SYNs that never complete,
+   * then open nconn connections. Return the number of accepted connections.
+   */
+  size_t flood(const size_t nconn, const size_t nsyn, const bool cookies)
+  {
+    transport::list::Device::List client_list;
+    transport::list::Device::List server_list;
+    /*
+     * Build the devices and the stacks.
+     */
+    transport::list::Device client(m_client_adr, m_client_ip4, m_bcast,
+                                   m_nmask, 1514, server_list, client_list);
+    transport::list::Device server(m_server_adr, m_server_ip4, m_bcast,
+                                   m_nmask, 1514, client_list, server_list);
+    Stack cstack(client, m_client_ip4, m_bcast, m_nmask, nsyn + nconn);
+    Stack sstack(server, m_server_ip4, m_bcast, m_nmask, nconn);
+    sstack.tcp.setSynCookies(cookies);
+    sstack.tcp.listen(1234);
+    /*
+     * Send the SYNs of the flood. The SYN/ACKs are dropped.
+     */
+    for (size_t i = 0; i < nsyn; i += 1) {
+      tcpv4::Connection::ID c;
+      EXPECT_EQ(Status::Ok,
+                cstack.tcp.connect(m_server_adr, m_server_ip4, 1234, c));
+      EXPECT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+      if (!server_list.empty()) {
+        client.drop();
+      }
+    }
+    /*
+     * Open the connections.
+     */
+    for (size_t i = 0; i < nconn; i += 1) {
+      tcpv4::Connection::ID c;
+      EXPECT_EQ(Status::Ok,
+                cstack.tcp.connect(m_server_adr, m_server_ip4, 1234, c));
+      EXPECT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+      if (server_list.empty()) {
+        continue;
+      }
+      EXPECT_EQ(Status::Ok, client.poll(cstack.eth_proc));
+      EXPECT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+    }
+    return sstack.evt.connected;
+  }
+
+  ethernet::Address m_client_adr;
+  ethernet::Address m_server_adr;
+  ipv4::Address m_bcast;
+  ipv4::Address m_nmask;
+  ipv4::Address m_client_ip4;
+  ipv4::Address m_server_ip4;
+};
+
+TEST_F(TCP_Accept, FillConnectionTable)
+{
+  for (size_t nconn = 16; nconn <= 8192; nconn <<= 3) {
+    fill(nconn);
+  }
+}
+
+TEST_F(TCP_Accept, SynFloodWithCookies)
+{
+  const size_t nconn = 64;
+  const size_t nsyn = 4096;
+  /*
+   * Without SYN cookies, the flood fills the connection table.
+   */
+  ASSERT_EQ(0, flood(nconn, nsyn, false));
+  /*
+   * With SYN cookies, the half-open connections of the flood are evicted.
+   */
+  ASSERT_EQ(nconn, flood(nconn, nsyn, true));
+}
+
+TEST_F(TCP_Accept, DataAfterCookieHandshake)
+{
+  transport::list::Device::List client_list;
+  transport::list::Device::List server_list;
+  /*
+   * Build the devices and the stacks.
+   */
+  transport::list::Device client(m_client_adr, m_client_ip4, m_bcast, m_nmask,
+                                 1514, server_list, client_list);
+  transport::list::Device server(m_server_adr, m_server_ip4, m_bcast, m_nmask,
+                                 1514, client_list, server_list);
+  Stack cstack(client, m_client_ip4, m_bcast, m_nmask, 2);
+  Stack sstack(server, m_server_ip4, m_bcast, m_nmask, 1);
+  sstack.tcp.setSynCookies(true);
+  sstack.tcp.listen(1234);
+  /*
+   * Fill the connection table with a half-open connection.
+   */
+  tcpv4::Connection::ID c;
+  ASSERT_EQ(Status::Ok,
+            cstack.tcp.connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+  ASSERT_EQ(Status::Ok, client.drop());
+  /*
+   * Open a connection. The server answers with a cookie, and the ACK that
+   * completes the handshake evicts the half-open connection.
+   */
+  ASSERT_EQ(Status::Ok,
+            cstack.tcp.connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+  ASSERT_EQ(Status::Ok, client.poll(cstack.eth_proc));
+  ASSERT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+  ASSERT_EQ(1, sstack.evt.connected);
+  /*
+   * Exchange data over the connection.
+   */
+  uint32_t off = 0;
+  uint64_t data = 0xdeadbeef;
+  ASSERT_EQ(Status::Ok, cstack.tcp.send(c, sizeof(data), (uint8_t*)&data, off));
+  ASSERT_EQ(sizeof(data), off);
+  ASSERT_EQ(Status::Ok, server.poll(sstack.eth_proc));
+  ASSERT_EQ(sizeof(data), sstack.evt.received);
+  ASSERT_EQ(Status::Ok, client.poll(cstack.eth_proc));
+}
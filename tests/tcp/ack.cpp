@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Processor.h>
+#include <tulips/stack/ipv4/Producer.h>
+#include <tulips/stack/ipv4/Processor.h>
+#include <tulips/stack/ethernet/Producer.h>
+#include <tulips/stack/ethernet/Processor.h>
+#include <tulips/system/Compiler.h>
+#include <tulips/transport/list/Device.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+using namespace tulips;
+using namespace stack;
+
+namespace {
+
+class Client : public tcpv4::EventHandler
+{
+public:
+  using tcpv4::EventHandler::onNewData;
+
+  Client() : m_connected(false), m_acked(0) {}
+
+  void onConnected(tcpv4::Connection& c) override
+  {
+    c.setOptions(tcpv4::Connection::NO_DELAY);
+    m_connected = true;
+  }
+
+  void onAborted(UNUSED tcpv4::Connection& c) override { m_connected = false; }
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override {}
+
+  void onSent(UNUSED tcpv4::Connection& c) override {}
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    m_acked += 1;
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    m_acked += 1;
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data, UNUSED const uint32_t len,
+                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
+                   UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override { m_connected = false; }
+
+  bool isConnected() const { return m_connected; }
+
+  uint64_t ackedCount() const { return m_acked; }
+
+private:
+  bool m_connected;
+  uint64_t m_acked;
+};
+
+class Server : public tcpv4::EventHandler
+{
+public:
+  using tcpv4::EventHandler::onNewData;
+
+  Server()
+    : m_connected(false)
+    , m_delayedack(false)
+    , m_coalesce(false)
+    , m_deliveries(0)
+    , m_fragments(0)
+  {}
+
+  void onConnected(tcpv4::Connection& c) override
+  {
+    if (m_delayedack) {
+      c.setOptions(tcpv4::Connection::DELAYED_ACK);
+    }
+    if (m_coalesce) {
+      c.setOptions(tcpv4::Connection::COALESCE);
+    }
+    m_connected = true;
+  }
+
+  void onAborted(UNUSED tcpv4::Connection& c) override { m_connected = false; }
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override {}
+
+  void onSent(UNUSED tcpv4::Connection& c) override {}
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data, UNUSED const uint32_t len,
+                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
+                   UNUSED uint32_t& slen) override
+  {
+    m_deliveries += 1;
+    m_fragments += 1;
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const transport::Frame* const frags,
+                   const size_t count, UNUSED const uint32_t alen,
+                   UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    m_deliveries += 1;
+    m_fragments += count;
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override { m_connected = false; }
+
+  bool isConnected() const { return m_connected; }
+
+  void setDelayedAck() { m_delayedack = true; }
+
+  void setCoalesce() { m_coalesce = true; }
+
+  size_t deliveryCount() const { return m_deliveries; }
+
+  size_t fragmentCount() const { return m_fragments; }
+
+private:
+  bool m_connected;
+  bool m_delayedack;
+  bool m_coalesce;
+  size_t m_deliveries;
+  size_t m_fragments;
+};
+
+/*
+ * Number of times the segment ring of the client is filled and drained.
+ */
+constexpr size_t ROUNDS = 4;
+
+} // namespace
+
+class TCP_Ack : public ::testing::Test
+{
+public:
+  using Packet = transport::list::Device::Packet;
+
+  TCP_Ack()
+    : m_client_list()
+    , m_server_list()
+    , m_client_adr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10)
+    , m_server_adr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20)
+    , m_bcast(10, 1, 0, 254)
+    , m_nmask(255, 255, 255, 0)
+    , m_client_ip4(10, 1, 0, 1)
+    , m_server_ip4(10, 1, 0, 2)
+    , m_client(nullptr)
+    , m_server(nullptr)
+    , m_client_evt(nullptr)
+    , m_client_ip4_prod(nullptr)
+    , m_client_ip4_proc(nullptr)
+    , m_client_tcp(nullptr)
+    , m_client_eth_prod(nullptr)
+    , m_client_eth_proc(nullptr)
+    , m_server_evt(nullptr)
+    , m_server_ip4_prod(nullptr)
+    , m_server_ip4_proc(nullptr)
+    , m_server_tcp(nullptr)
+    , m_server_eth_prod(nullptr)
+    , m_server_eth_proc(nullptr)
+  {}
+
+protected:
+  void SetUp() override
+  {
+    /*
+     * Build the devices.
+     */
+    m_client = new transport::list::Device(m_client_adr, m_client_ip4,
+                                           m_bcast, m_nmask, 1514,
+                                           m_server_list, m_client_list);
+    m_server = new transport::list::Device(m_server_adr, m_server_ip4,
+                                           m_bcast, m_nmask, 1514,
+                                           m_client_list, m_server_list);
+    /*
+     * Client stack
+     */
+    m_client_evt = new Client();
+    m_client_eth_prod = new ethernet::Producer(*m_client, m_client->address());
+    m_client_ip4_prod = new ipv4::Producer(*m_client_eth_prod, m_client_ip4);
+    m_client_eth_proc = new ethernet::Processor(m_client->address());
+    m_client_ip4_proc = new ipv4::Processor(m_client_ip4);
+    m_client_tcp = new tcpv4::Processor(*m_client, *m_client_eth_prod,
+                                        *m_client_ip4_prod, *m_client_evt, 2);
+    /*
+     * Client processor binding
+     */
+    (*m_client_tcp)
+      .setEthernetProcessor(*m_client_eth_proc)
+      .setIPv4Processor(*m_client_ip4_proc);
+    (*m_client_ip4_prod).setDefaultRouterAddress(m_bcast).setNetMask(m_nmask);
+    (*m_client_ip4_proc)
+      .setEthernetProcessor(*m_client_eth_proc)
+      .setTCPv4Processor(*m_client_tcp);
+    (*m_client_eth_proc).setIPv4Processor(*m_client_ip4_proc);
+    /*
+     * Server stack
+     */
+    m_server_evt = new Server();
+    m_server_eth_prod = new ethernet::Producer(*m_server, m_server->address());
+    m_server_ip4_prod = new ipv4::Producer(*m_server_eth_prod, m_server_ip4);
+    m_server_eth_proc = new ethernet::Processor(m_server->address());
+    m_server_ip4_proc = new ipv4::Processor(m_server_ip4);
+    m_server_tcp = new tcpv4::Processor(*m_server, *m_server_eth_prod,
+                                        *m_server_ip4_prod, *m_server_evt, 2);
+    /*
+     * Server processor binding
+     */
+    (*m_server_tcp)
+      .setEthernetProcessor(*m_server_eth_proc)
+      .setIPv4Processor(*m_server_ip4_proc);
+    (*m_server_ip4_prod).setDefaultRouterAddress(m_bcast).setNetMask(m_nmask);
+    (*m_server_ip4_proc)
+      .setEthernetProcessor(*m_server_eth_proc)
+      .setTCPv4Processor(*m_server_tcp);
+    (*m_server_eth_proc).setIPv4Processor(*m_server_ip4_proc);
+    /*
+     * TCP server listens
+     */
+    m_server_tcp->listen(1234);
+  }
+
+  void TearDown() override
+  {
+    /*
+     * Delete client stack.
+     */
+    delete m_client_evt;
+    delete m_client_ip4_proc;
+    delete m_client_ip4_prod;
+    delete m_client_tcp;
+    delete m_client_eth_proc;
+    delete m_client_eth_prod;
+    /*
+     * Delete server stack.
+     */
+    delete m_server_evt;
+    delete m_server_ip4_proc;
+    delete m_server_ip4_prod;
+    delete m_server_tcp;
+    delete m_server_eth_proc;
+    delete m_server_eth_prod;
+    /*
+     * Delete client and server.
+     */
+    delete m_client;
+    delete m_server;
+    /*
+     * Release the packets.
+     */
+    for (auto* p : m_client_list) {
+      Packet::release(p);
+    }
+    for (auto* p : m_server_list) {
+      Packet::release(p);
+    }
+  }
+
+  transport::list::Device::List m_client_list;
+  transport::list::Device::List m_server_list;
+  ethernet::Address m_client_adr;
+  ethernet::Address m_server_adr;
+  ipv4::Address m_bcast;
+  ipv4::Address m_nmask;
+  ipv4::Address m_client_ip4;
+  ipv4::Address m_server_ip4;
+  transport::list::Device* m_client;
+  transport::list::Device* m_server;
+  Client* m_client_evt;
+  ipv4::Producer* m_client_ip4_prod;
+  ipv4::Processor* m_client_ip4_proc;
+  tcpv4::Processor* m_client_tcp;
+  ethernet::Producer* m_client_eth_prod;
+  ethernet::Processor* m_client_eth_proc;
+  Server* m_server_evt;
+  ipv4::Producer* m_server_ip4_prod;
+  ipv4::Processor* m_server_ip4_proc;
+  tcpv4::Processor* m_server_tcp;
+  ethernet::Producer* m_server_eth_prod;
+  ethernet::Processor* m_server_eth_proc;
+};
+
+TEST_F(TCP_Ack, OneAckPerSegment)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Server listens, client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * Fill the segment ring and have the server acknowledge every segment.
+   */
+  uint64_t pld = 0xdeadbeefULL;
+  size_t segs = 0;
+  size_t acks = 0;
+  for (size_t i = 0; i < ROUNDS; i += 1) {
+    uint32_t off = 0;
+    while (m_client_tcp->send(c, 8, (uint8_t*)&pld, off) == Status::Ok) {
+      segs += 1;
+      off = 0;
+    }
+    while (!m_client_list.empty()) {
+      ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+    }
+    while (!m_server_list.empty()) {
+      ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+      acks += 1;
+    }
+  }
+  /*
+   * Every ACK acknowledged exactly one segment.
+   */
+  ASSERT_GT(segs, ROUNDS);
+  ASSERT_EQ(segs, acks);
+  ASSERT_EQ(acks, m_client_evt->ackedCount());
+  bool res = true;
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, res));
+  ASSERT_FALSE(res);
+}
+
+TEST_F(TCP_Ack, DelayedAckInBurst)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Put the server in delayed ACK mode.
+   */
+  m_server_evt->setDelayedAck();
+  /*
+   * Server listens, client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * The client sends three segments.
+   */
+  uint64_t pld = 0xdeadbeefULL;
+  for (size_t i = 0; i < 3; i += 1) {
+    uint32_t off = 0;
+    ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, off));
+  }
+  ASSERT_EQ(3, m_client_list.size());
+  /*
+   * The server processes them as one burst. The second segment is
+   * acknowledged right away, the third one at the end of the burst.
+   */
+  transport::Frame frames[3];
+  size_t count = 0;
+  for (auto* p : m_client_list) {
+    frames[count].len = p->len;
+    frames[count].data = p->data;
+    count += 1;
+  }
+  ASSERT_EQ(Status::Ok, m_server_eth_proc->process(count, frames));
+  for (auto* p : m_client_list) {
+    Packet::release(p);
+  }
+  m_client_list.clear();
+  ASSERT_EQ(2, m_server_list.size());
+  ASSERT_EQ(1, m_server_tcp->statistics().delack);
+  /*
+   * The client gets all its data acknowledged.
+   */
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(2, m_client_evt->ackedCount());
+  bool res = true;
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, res));
+  ASSERT_FALSE(res);
+}
+
+TEST_F(TCP_Ack, DelayedAckIsBounded)
+{
+  tcpv4::Connection::ID c0, c1;
+  /*
+   * Put the server in delayed ACK mode.
+   */
+  m_server_evt->setDelayedAck();
+  /*
+   * Server listens, client connects twice.
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c0));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c1));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  /*
+   * The server delays the ACK of a segment received outside of a burst.
+   */
+  uint64_t pld = 0xdeadbeefULL;
+  uint32_t off = 0;
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c0, 8, (uint8_t*)&pld, off));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_server_list.empty());
+  ASSERT_EQ(0, m_server_tcp->statistics().delack);
+  /*
+   * Once the delay has expired, the next segment flushes the delayed ACKs,
+   * even though the processor did not run.
+   */
+  std::this_thread::sleep_for(
+    std::chrono::milliseconds(tcpv4::DELACK_TIMEOUT + 50));
+  off = 0;
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c1, 8, (uint8_t*)&pld, off));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(2, m_server_list.size());
+  ASSERT_EQ(2, m_server_tcp->statistics().delack);
+  /*
+   * The client gets all its data acknowledged.
+   */
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(2, m_client_evt->ackedCount());
+}
+
+TEST_F(TCP_Ack, CoalesceInBurst)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Put the server in coalescing mode.
+   */
+  m_server_evt->setCoalesce();
+  /*
+   * Server listens, client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * The client sends three segments.
+   */
+  uint64_t pld = 0xdeadbeefULL;
+  for (size_t i = 0; i < 3; i += 1) {
+    uint32_t off = 0;
+    ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, off));
+  }
+  ASSERT_EQ(3, m_client_list.size());
+  /*
+   * The server processes them as one burst. The segments are delivered at once
+   * and acknowledged with a single cumulative ACK.
+   */
+  transport::Frame frames[3];
+  size_t count = 0;
+  for (auto* p : m_client_list) {
+    frames[count].len = p->len;
+    frames[count].data = p->data;
+    count += 1;
+  }
+  ASSERT_EQ(Status::Ok, m_server_eth_proc->process(count, frames));
+  for (auto* p : m_client_list) {
+    Packet::release(p);
+  }
+  m_client_list.clear();
+  ASSERT_EQ(1, m_server_evt->deliveryCount());
+  ASSERT_EQ(3, m_server_evt->fragmentCount());
+  ASSERT_EQ(3, m_server_tcp->statistics().gro);
+  ASSERT_EQ(1, m_server_list.size());
+  /*
+   * The client gets all its data acknowledged.
+   */
+  ASSERT_EQ(Status::Ok, m_client->poll(*m_client_eth_proc));
+  ASSERT_EQ(1, m_client_evt->ackedCount());
+  bool res = true;
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, res));
+  ASSERT_FALSE(res);
+}
@@ -45,6 +45,8 @@ namespace {
 class Client : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Client(std::string const& fn) : m_out(), m_connected(false)
   {
     m_out.open(fn.c_str());
@@ -120,6 +122,8 @@ private:
 class Server : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Server(std::string const& fn)
     : m_out(), m_connected(false), m_cid(-1), m_rlen(0)
   {
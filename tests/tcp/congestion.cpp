@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2020, International Business Machines
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tulips/stack/tcpv4/Processor.h>
+#include <tulips/stack/ipv4/Producer.h>
+#include <tulips/stack/ipv4/Processor.h>
+#include <tulips/stack/ethernet/Producer.h>
+#include <tulips/stack/ethernet/Processor.h>
+#include <tulips/system/Compiler.h>
+#include <tulips/transport/list/Device.h>
+#include <tulips/transport/pcap/Device.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace tulips;
+using namespace stack;
+
+namespace {
+
+class Client : public tcpv4::EventHandler
+{
+public:
+  using tcpv4::EventHandler::onNewData;
+
+  Client(std::string const& fn) : m_out(), m_connected(false), m_opts(0)
+  {
+    m_out.open(fn.c_str());
+  }
+
+  ~Client() override { m_out.close(); }
+
+  void onConnected(tcpv4::Connection& c) override
+  {
+    m_out << "onConnected:" << std::endl;
+    c.setOptions(tcpv4::Connection::NO_DELAY | m_opts);
+    m_connected = true;
+  }
+
+  void onAborted(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onAborted:" << std::endl;
+    m_connected = false;
+  }
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onTimedOut:" << std::endl;
+  }
+
+  void onSent(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onSent:" << std::endl;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   UNUSED const uint32_t len) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data, UNUSED const uint32_t len,
+                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
+                   UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onClosed:" << std::endl;
+    m_connected = false;
+  }
+
+  bool isConnected() const { return m_connected; }
+
+  void setOptions(const uint16_t opts) { m_opts = opts; }
+
+private:
+  std::ofstream m_out;
+  bool m_connected;
+  uint16_t m_opts;
+};
+
+class Server : public tcpv4::EventHandler
+{
+public:
+  using tcpv4::EventHandler::onNewData;
+
+  Server(std::string const& fn) : m_out(), m_connected(false), m_rlen(0)
+  {
+    m_out.open(fn.c_str());
+  }
+
+  ~Server() override { m_out.close(); }
+
+  void onConnected(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onConnected:" << std::endl;
+    m_connected = true;
+  }
+
+  void onAborted(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onAborted:" << std::endl;
+    m_connected = false;
+  }
+
+  void onTimedOut(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onTimedOut:" << std::endl;
+  }
+
+  void onSent(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onSent:" << std::endl;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c) override
+  {
+    return Action::Continue;
+  }
+
+  Action onAcked(UNUSED tcpv4::Connection& c, UNUSED const uint32_t alen,
+                 UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
+  {
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data,
+                   const uint32_t len) override
+  {
+    m_rlen += len;
+    return Action::Continue;
+  }
+
+  Action onNewData(UNUSED tcpv4::Connection& c,
+                   UNUSED const uint8_t* const data, const uint32_t len,
+                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
+                   UNUSED uint32_t& slen) override
+  {
+    m_rlen += len;
+    return Action::Continue;
+  }
+
+  void onClosed(UNUSED tcpv4::Connection& c) override
+  {
+    m_out << "onClosed:" << std::endl;
+    m_connected = false;
+  }
+
+  bool isConnected() const { return m_connected; }
+
+  uint64_t receivedLength() const { return m_rlen; }
+
+private:
+  std::ofstream m_out;
+  bool m_connected;
+  uint64_t m_rlen;
+};
+
+/*
+ * Segment payload, bottleneck queue limit and marking threshold (in packets),
+ * and test duration limit (in ticks).
+ */
+constexpr size_t PAYLOAD = 1460;
+constexpr size_t QUEUE_LIMIT = 12;
+constexpr size_t MARK_THRESHOLD = 3;
+constexpr uint64_t MAX_TICKS = 100000;
+
+/*
+ * Outcome of a transfer through the bottleneck.
+ */
+struct Result
+{
+  uint64_t ticks;    // Duration of the transfer, in link ticks.
+  uint64_t bytes;    // Number of bytes delivered to the server.
+  uint64_t drops;    // Number of packets dropped by the bottleneck.
+  uint64_t marks;    // Number of packets marked CE by the bottleneck.
+  uint64_t forwards; // Number of packets forwarded by the bottleneck.
+  uint64_t delay;    // Total queueing delay, in link ticks.
+  uint64_t maxq;     // Maximum queue length, in packets.
+};
+
+} // namespace
+
+/*
+ * The client and the server are connected through a bottleneck link that
+ * forwards one packet per tick from the client to the server. The link has a
+ * drop-tail queue and marks ECN-capable packets with CE when the queue is
+ * above a threshold. The path from the server to the client is not
+ * congested.
+ */
+class TCP_Congestion : public ::testing::Test
+{
+public:
+  using Packet = transport::list::Device::Packet;
+
+  TCP_Congestion()
+    : m_client_list()
+    , m_server_list()
+    , m_link_list()
+    , m_queue()
+    , m_sent()
+    , m_client_adr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10)
+    , m_server_adr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20)
+    , m_bcast(10, 1, 0, 254)
+    , m_nmask(255, 255, 255, 0)
+    , m_client_ip4(10, 1, 0, 1)
+    , m_server_ip4(10, 1, 0, 2)
+    , m_client(nullptr)
+    , m_server(nullptr)
+    , m_client_pcap(nullptr)
+    , m_server_pcap(nullptr)
+    , m_client_evt(nullptr)
+    , m_client_ip4_prod(nullptr)
+    , m_client_ip4_proc(nullptr)
+    , m_client_tcp(nullptr)
+    , m_client_eth_prod(nullptr)
+    , m_client_eth_proc(nullptr)
+    , m_server_evt(nullptr)
+    , m_server_ip4_prod(nullptr)
+    , m_server_ip4_proc(nullptr)
+    , m_server_tcp(nullptr)
+    , m_server_eth_prod(nullptr)
+    , m_server_eth_proc(nullptr)
+  {}
+
+protected:
+  void SetUp() override
+  {
+    std::string tname(
+      ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    /*
+     * Build the devices. The client writes to the client list, which is the
+     * input of the bottleneck. The server reads the output of the bottleneck.
+     */
+    m_client = new transport::list::Device(m_client_adr, m_client_ip4,
+                                           m_bcast, m_nmask, 1514,
+                                           m_server_list, m_client_list);
+    m_server = new transport::list::Device(m_server_adr, m_server_ip4,
+                                           m_bcast, m_nmask, 1514, m_link_list,
+                                           m_server_list);
+    /*
+     * Build the pcap device
+     */
+    std::string client_n = "tcp_congestion.client." + tname;
+    std::string server_n = "tcp_congestion.server." + tname;
+    m_client_pcap = new transport::pcap::Device(*m_client, client_n + ".pcap");
+    m_server_pcap = new transport::pcap::Device(*m_server, server_n + ".pcap");
+    /*
+     * Client stack
+     */
+    m_client_evt = new Client(client_n + ".log");
+    m_client_eth_prod =
+      new ethernet::Producer(*m_client_pcap, m_client_pcap->address());
+    m_client_ip4_prod = new ipv4::Producer(*m_client_eth_prod, m_client_ip4);
+    m_client_eth_proc = new ethernet::Processor(m_client_pcap->address());
+    m_client_ip4_proc = new ipv4::Processor(m_client_ip4);
+    m_client_tcp = new tcpv4::Processor(*m_client_pcap, *m_client_eth_prod,
+                                        *m_client_ip4_prod, *m_client_evt, 1);
+    /*
+     * Client processor binding
+     */
+    (*m_client_tcp)
+      .setEthernetProcessor(*m_client_eth_proc)
+      .setIPv4Processor(*m_client_ip4_proc);
+    (*m_client_ip4_prod).setDefaultRouterAddress(m_bcast).setNetMask(m_nmask);
+    (*m_client_ip4_proc)
+      .setEthernetProcessor(*m_client_eth_proc)
+      .setTCPv4Processor(*m_client_tcp);
+    (*m_client_eth_proc).setIPv4Processor(*m_client_ip4_proc);
+    /*
+     * Server stack
+     */
+    m_server_evt = new Server(server_n + ".log");
+    m_server_eth_prod =
+      new ethernet::Producer(*m_server_pcap, m_server_pcap->address());
+    m_server_ip4_prod = new ipv4::Producer(*m_server_eth_prod, m_server_ip4);
+    m_server_eth_proc = new ethernet::Processor(m_server_pcap->address());
+    m_server_ip4_proc = new ipv4::Processor(m_server_ip4);
+    m_server_tcp = new tcpv4::Processor(*m_server_pcap, *m_server_eth_prod,
+                                        *m_server_ip4_prod, *m_server_evt, 1);
+    /*
+     * Server processor binding
+     */
+    (*m_server_tcp)
+      .setEthernetProcessor(*m_server_eth_proc)
+      .setIPv4Processor(*m_server_ip4_proc);
+    (*m_server_ip4_prod).setDefaultRouterAddress(m_bcast).setNetMask(m_nmask);
+    (*m_server_ip4_proc)
+      .setEthernetProcessor(*m_server_eth_proc)
+      .setTCPv4Processor(*m_server_tcp);
+    (*m_server_eth_proc).setIPv4Processor(*m_server_ip4_proc);
+    /*
+     * TCP server listens
+     */
+    m_server_tcp->listen(1234);
+  }
+
+  void TearDown() override
+  {
+    /*
+     * Delete client stack.
+     */
+    delete m_client_evt;
+    delete m_client_ip4_proc;
+    delete m_client_ip4_prod;
+    delete m_client_tcp;
+    delete m_client_eth_proc;
+    delete m_client_eth_prod;
+    /*
+     * Delete server stack.
+     */
+    delete m_server_evt;
+    delete m_server_ip4_proc;
+    delete m_server_ip4_prod;
+    delete m_server_tcp;
+    delete m_server_eth_proc;
+    delete m_server_eth_prod;
+    /*
+     * Delete the pcap wrappers;
+     */
+    delete m_client_pcap;
+    delete m_server_pcap;
+    /*
+     * Delete client and server.
+     */
+    delete m_client;
+    delete m_server;
+    /*
+     * Release the packets.
+     */
+    for (auto* p : m_client_list) {
+      Packet::release(p);
+    }
+    for (auto* p : m_server_list) {
+      Packet::release(p);
+    }
+    for (auto* p : m_link_list) {
+      Packet::release(p);
+    }
+    for (auto const& e : m_queue) {
+      Packet::release(e.first);
+    }
+    for (auto* p : m_sent) {
+      Packet::release(p);
+    }
+  }
+
+  /*
+   * Move the packets sent by the client into the bottleneck queue. The client
+   * packets are kept until the end of the test as the client retransmits from
+   * them, and copies are queued instead.
+   */
+  void enqueue(const uint64_t tick, Result& res)
+  {
+    while (!m_client_list.empty()) {
+      Packet* p = m_client_list.front();
+      m_client_list.pop_front();
+      m_sent.push_back(p);
+      /*
+       * Drop the packet if the queue is full.
+       */
+      if (m_queue.size() >= QUEUE_LIMIT) {
+        res.drops += 1;
+        continue;
+      }
+      Packet* q = Packet::allocate(1514);
+      memcpy(q->data, p->data, p->len);
+      q->len = p->len;
+      /*
+       * Mark the packet if it is ECN-capable and the queue is too long.
+       */
+      auto* ip = (ipv4::Header*)(q->data + ethernet::HEADER_LEN);
+      if ((ip->tos & ipv4::ECN_MASK) != ipv4::ECN_NOT_ECT &&
+          m_queue.size() >= MARK_THRESHOLD) {
+        ip->tos |= ipv4::ECN_CE;
+        ip->ipchksum = 0;
+        ip->ipchksum = ~ipv4::checksum((uint8_t*)ip);
+        res.marks += 1;
+      }
+      m_queue.emplace_back(q, tick);
+      res.maxq = m_queue.size() > res.maxq ? m_queue.size() : res.maxq;
+    }
+  }
+
+  /*
+   * Forward one packet from the bottleneck queue to the server.
+   */
+  void forward(const uint64_t tick, Result& res)
+  {
+    if (m_queue.empty()) {
+      return;
+    }
+    res.forwards += 1;
+    res.delay += tick - m_queue.front().second;
+    m_link_list.push_back(m_queue.front().first);
+    m_queue.pop_front();
+  }
+
+  /*
+   * Transfer a number of segments from the client to the server through the
+   * bottleneck, using the given congestion control option.
+   */
+  void transfer(const uint16_t opts, const size_t count, Result& res)
+  {
+    const system::Clock::Value tick = CLOCK_SECOND / 100000;
+    const uint64_t total = count * PAYLOAD;
+    uint8_t pld[PAYLOAD] = { 0 };
+    tcpv4::Connection::ID c;
+    size_t sent = 0;
+    memset(&res, 0, sizeof(res));
+    /*
+     * Bound the client RTO to [20 ticks, 1s].
+     */
+    m_client_tcp->setRtoBounds(20 * tick, CLOCK_SECOND);
+    m_client_evt->setOptions(opts);
+    /*
+     * Client connects.
+     */
+    ASSERT_EQ(Status::Ok,
+              m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+    /*
+     * Run the link.
+     */
+    for (uint64_t t = 0; t < MAX_TICKS; t += 1) {
+      /*
+       * The client sends as much as it can.
+       */
+      while (m_client_evt->isConnected() && sent < count) {
+        uint32_t off = 0;
+        if (m_client_tcp->send(c, PAYLOAD, pld, off) != Status::Ok) {
+          break;
+        }
+        ASSERT_EQ(PAYLOAD, off);
+        sent += 1;
+      }
+      /*
+       * Move the packets through the bottleneck.
+       */
+      enqueue(t, res);
+      forward(t, res);
+      /*
+       * The server processes its input, the client processes the ACKs.
+       */
+      while (!m_link_list.empty()) {
+        m_server_pcap->poll(*m_server_eth_proc);
+      }
+      while (!m_server_list.empty()) {
+        m_client_pcap->poll(*m_client_eth_proc);
+      }
+      /*
+       * Advance time and run the client timers.
+       */
+      system::Clock::get().offsetBy(tick);
+      m_client_eth_proc->run();
+      /*
+       * Stop when all the data has been delivered.
+       */
+      if (m_server_evt->receivedLength() == total) {
+        res.ticks = t + 1;
+        break;
+      }
+    }
+    res.bytes = m_server_evt->receivedLength();
+  }
+
+  /*
+   * Report the goodput, relative to the link capacity, and the queueing delay
+   * of a transfer.
+   */
+  static void report(std::string const& name, Result const& res)
+  {
+    double capacity = (double)res.ticks * PAYLOAD;
+    double delay = res.forwards == 0 ? 0 : (double)res.delay / res.forwards;
+    std::cout << std::setw(8) << name << ": goodput " << std::fixed
+              << std::setprecision(1) << 100.0 * res.bytes / capacity
+              << "% of link, queueing delay " << delay << " ticks (max queue "
+              << res.maxq << "), " << res.drops << " drops, " << res.marks
+              << " marks" << std::endl;
+  }
+
+  transport::list::Device::List m_client_list;
+  transport::list::Device::List m_server_list;
+  transport::list::Device::List m_link_list;
+  std::deque<std::pair<Packet*, uint64_t>> m_queue;
+  std::vector<Packet*> m_sent;
+  ethernet::Address m_client_adr;
+  ethernet::Address m_server_adr;
+  ipv4::Address m_bcast;
+  ipv4::Address m_nmask;
+  ipv4::Address m_client_ip4;
+  ipv4::Address m_server_ip4;
+  transport::list::Device* m_client;
+  transport::list::Device* m_server;
+  transport::pcap::Device* m_client_pcap;
+  transport::pcap::Device* m_server_pcap;
+  Client* m_client_evt;
+  ipv4::Producer* m_client_ip4_prod;
+  ipv4::Processor* m_client_ip4_proc;
+  tcpv4::Processor* m_client_tcp;
+  ethernet::Producer* m_client_eth_prod;
+  ethernet::Processor* m_client_eth_proc;
+  Server* m_server_evt;
+  ipv4::Producer* m_server_ip4_prod;
+  ipv4::Processor* m_server_ip4_proc;
+  tcpv4::Processor* m_server_tcp;
+  ethernet::Producer* m_server_eth_prod;
+  ethernet::Processor* m_server_eth_proc;
+};
+
+TEST_F(TCP_Congestion, BottleneckNewReno)
+{
+  Result res;
+  transfer(tcpv4::Connection::NEWRENO, 1000, res);
+  report("NewReno", res);
+  ASSERT_EQ(1000 * PAYLOAD, res.bytes);
+  /*
+   * NewReno fills the queue until it overflows.
+   */
+  ASSERT_GT(res.drops, 0);
+  ASSERT_EQ(QUEUE_LIMIT, res.maxq);
+}
+
+TEST_F(TCP_Congestion, BottleneckCubic)
+{
+  Result res;
+  transfer(tcpv4::Connection::CUBIC, 1000, res);
+  report("CUBIC", res);
+  ASSERT_EQ(1000 * PAYLOAD, res.bytes);
+  /*
+   * CUBIC fills the queue until it overflows.
+   */
+  ASSERT_GT(res.drops, 0);
+  ASSERT_EQ(QUEUE_LIMIT, res.maxq);
+}
+
+TEST_F(TCP_Congestion, BottleneckDctcp)
+{
+  Result res;
+  transfer(tcpv4::Connection::DCTCP, 1000, res);
+  report("DCTCP", res);
+  ASSERT_EQ(1000 * PAYLOAD, res.bytes);
+  /*
+   * DCTCP reacts to the marks and keeps the queue short without losses, and
+   * without losing throughput.
+   */
+  ASSERT_GT(res.marks, 0);
+  ASSERT_EQ(0, res.drops);
+  ASSERT_LT(res.delay, res.forwards * (MARK_THRESHOLD + 1));
+  ASSERT_GT(10 * res.bytes, 9 * res.ticks * PAYLOAD);
+}
@@ -45,6 +45,8 @@ namespace {
 class Client : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Client(std::string const& fn) : m_out(), m_connected(false)
   {
     m_out.open(fn.c_str());
@@ -120,6 +122,8 @@ private:
 class Server : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Server(std::string const& fn)
     : m_out(), m_connected(false), m_cid(-1), m_rlen(0)
   {
@@ -247,10 +251,10 @@ protected:
     m_client_fifo = TULIPS_FIFO_DEFAULT_VALUE;
     m_server_fifo = TULIPS_FIFO_DEFAULT_VALUE;
     /*
-     * Build the FIFOs
+     * Build the FIFOs, deep enough to hold twice the number of segments.
      */
-    tulips_fifo_create(32, 128, &m_client_fifo);
-    tulips_fifo_create(32, 128, &m_server_fifo);
+    tulips_fifo_create(2 << SEGM_B, 128, &m_client_fifo);
+    tulips_fifo_create(2 << SEGM_B, 128, &m_server_fifo);
     /*
      * Build the devices.
      */
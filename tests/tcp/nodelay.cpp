@@ -36,6 +36,7 @@
 #include <tulips/transport/Processor.h>
 #include <gtest/gtest.h>
 #include <fstream>
+#include <vector>
 
 using namespace tulips;
 using namespace stack;
@@ -45,7 +46,10 @@ namespace {
 class Client : public tcpv4::EventHandler
 {
 public:
-  Client(std::string const& fn) : m_out(), m_connected(false)
+  using tcpv4::EventHandler::onNewData;
+
+  Client(std::string const& fn)
+    : m_out(), m_connected(false), m_segmentation(false), m_released(0)
   {
     m_out.open(fn.c_str());
   }
@@ -56,6 +60,9 @@ public:
   {
     m_out << "onConnected:" << std::endl;
     c.setOptions(tcpv4::Connection::NO_DELAY);
+    if (m_segmentation) {
+      c.setOptions(tcpv4::Connection::SEGMENTATION);
+    }
     m_connected = true;
   }
 
@@ -113,16 +120,43 @@ public:
 
   bool isConnected() const { return m_connected; }
 
+  void onReleased(UNUSED tcpv4::Connection& c, const uint8_t* const data,
+                  const uint32_t len) override
+  {
+    m_out << "onReleased: " << len << "B" << std::endl;
+    m_released += len;
+    m_releasedData.push_back(data);
+  }
+
+  void setSegmentation() { m_segmentation = true; }
+
+  uint32_t releasedLength() const { return m_released; }
+
+  std::vector<const uint8_t*> const& releasedData() const
+  {
+    return m_releasedData;
+  }
+
 private:
   std::ofstream m_out;
   bool m_connected;
+  bool m_segmentation;
+  uint32_t m_released;
+  std::vector<const uint8_t*> m_releasedData;
 };
 
 class Server : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Server(std::string const& fn)
-    : m_out(), m_connected(false), m_cid(-1), m_rlen(0), m_pushed(false)
+    : m_out()
+    , m_connected(false)
+    , m_cid(-1)
+    , m_rlen(0)
+    , m_pushed(false)
+    , m_delayedack(false)
   {
     m_out.open(fn.c_str());
   }
@@ -132,6 +166,9 @@ public:
   void onConnected(tcpv4::Connection& c) override
   {
     m_out << "onConnected:" << std::endl;
+    if (m_delayedack) {
+      c.setOptions(tcpv4::Connection::DELAYED_ACK);
+    }
     m_connected = true;
     m_cid = c.id();
   }
@@ -166,23 +203,23 @@ public:
     return Action::Continue;
   }
 
-  Action onNewData(UNUSED tcpv4::Connection& c,
-                   UNUSED const uint8_t* const data,
+  Action onNewData(UNUSED tcpv4::Connection& c, const uint8_t* const data,
                    const uint32_t len) override
   {
     m_out << "onNewData:" << std::endl;
     m_rlen = len;
+    m_rdata.assign(data, data + len);
     m_pushed = c.isNewDataPushed();
     return Action::Continue;
   }
 
-  Action onNewData(UNUSED tcpv4::Connection& c,
-                   UNUSED const uint8_t* const data, const uint32_t len,
-                   UNUSED const uint32_t alen, UNUSED uint8_t* const sdata,
-                   UNUSED uint32_t& slen) override
+  Action onNewData(UNUSED tcpv4::Connection& c, const uint8_t* const data,
+                   const uint32_t len, UNUSED const uint32_t alen,
+                   UNUSED uint8_t* const sdata, UNUSED uint32_t& slen) override
   {
     m_out << "onNewData:" << std::endl;
     m_rlen = len;
+    m_rdata.assign(data, data + len);
     m_pushed = c.isNewDataPushed();
     return Action::Continue;
   }
@@ -200,14 +237,20 @@ public:
 
   uint32_t receivedLength() const { return m_rlen; }
 
+  std::vector<uint8_t> const& receivedData() const { return m_rdata; }
+
   bool dataWasPushed() const { return m_pushed; }
 
+  void setDelayedAck() { m_delayedack = true; }
+
 private:
   std::ofstream m_out;
   bool m_connected;
   tcpv4::Connection::ID m_cid;
   uint32_t m_rlen;
+  std::vector<uint8_t> m_rdata;
   bool m_pushed;
+  bool m_delayedack;
 };
 
 } // namespace
@@ -436,3 +479,302 @@ TEST_F(TCP_NoDelay, ConnectSend)
    */
   delete[] pld;
 }
+
+TEST_F(TCP_NoDelay, ConnectSendSegmentation)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Put the client in segmentation mode.
+   */
+  m_client_evt->setSegmentation();
+  /*
+   * Client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * Client sends the whole payload at once
+   */
+  uint32_t res = 0;
+  auto* pld = new uint8_t[200];
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 200, pld, res));
+  ASSERT_EQ(200, res);
+  /*
+   * The server receives it in three segments, the last one being pushed.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(70, m_server_evt->receivedLength());
+  ASSERT_FALSE(m_server_evt->dataWasPushed());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(70, m_server_evt->receivedLength());
+  ASSERT_FALSE(m_server_evt->dataWasPushed());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(60, m_server_evt->receivedLength());
+  ASSERT_TRUE(m_server_evt->dataWasPushed());
+  ASSERT_EQ(Status::NoDataAvailable, m_server_pcap->poll(*m_server_eth_proc));
+  /*
+   * The client gets all its data acknowledged.
+   */
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  bool outstanding = true;
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, outstanding));
+  ASSERT_FALSE(outstanding);
+  /*
+   * Clean-up
+   */
+  delete[] pld;
+}
+
+TEST_F(TCP_NoDelay, ConnectSendZeroCopy)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Put the client in segmentation mode.
+   */
+  m_client_evt->setSegmentation();
+  /*
+   * Client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * Client sends the whole payload at once, without copy
+   */
+  uint32_t res = 0;
+  auto* pld = new uint8_t[200];
+  for (size_t i = 0; i < 200; i += 1) {
+    pld[i] = i;
+  }
+  ASSERT_EQ(Status::Ok, m_client_tcp->sendZeroCopy(c, 200, pld, res));
+  ASSERT_EQ(200, res);
+  /*
+   * The server receives it in three valid segments.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(70, m_server_evt->receivedLength());
+  ASSERT_EQ(std::vector<uint8_t>(pld, pld + 70), m_server_evt->receivedData());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(70, m_server_evt->receivedLength());
+  ASSERT_EQ(std::vector<uint8_t>(pld + 70, pld + 140),
+            m_server_evt->receivedData());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(60, m_server_evt->receivedLength());
+  ASSERT_EQ(std::vector<uint8_t>(pld + 140, pld + 200),
+            m_server_evt->receivedData());
+  ASSERT_TRUE(m_server_evt->dataWasPushed());
+  /*
+   * The data is released as it gets acknowledged, segment by segment.
+   */
+  ASSERT_EQ(0, m_client_evt->releasedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(70, m_client_evt->releasedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(200, m_client_evt->releasedLength());
+  std::vector<const uint8_t*> released = { pld, pld + 70, pld + 140 };
+  ASSERT_EQ(released, m_client_evt->releasedData());
+  /*
+   * The client sends more data, but the segment is lost.
+   */
+  for (size_t i = 0; i < 50; i += 1) {
+    pld[i] = 0xff - i;
+  }
+  res = 0;
+  ASSERT_EQ(Status::Ok, m_client_tcp->sendZeroCopy(c, 50, pld, res));
+  ASSERT_EQ(50, res);
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  /*
+   * The retransmission carries the same payload, and the data is released
+   * once acknowledged.
+   */
+  system::Clock::get().offsetBy(2 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(50, m_server_evt->receivedLength());
+  ASSERT_EQ(std::vector<uint8_t>(pld, pld + 50), m_server_evt->receivedData());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(250, m_client_evt->releasedLength());
+  ASSERT_EQ(pld, m_client_evt->releasedData().back());
+  /*
+   * Clean-up
+   */
+  delete[] pld;
+}
+
+TEST_F(TCP_NoDelay, ConnectSendVectored)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * Client sends a header, an empty fragment and a body.
+   */
+  uint32_t res = 0;
+  uint8_t hdr[50];
+  auto* pld = new uint8_t[150];
+  struct iovec iov[3] = {
+    { hdr, sizeof(hdr) },
+    { nullptr, 0 },
+    { pld, 150 },
+  };
+  ASSERT_EQ(Status::InvalidArgument, m_client_tcp->sendv(c, iov, 0, res));
+  /*
+   * The first segment spans the header and the beginning of the body.
+   */
+  ASSERT_EQ(Status::Ok, m_client_tcp->sendv(c, iov, 3, res));
+  ASSERT_EQ(70, res);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(70, m_server_evt->receivedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  /*
+   * The following segments resume from the offset.
+   */
+  ASSERT_EQ(Status::Ok, m_client_tcp->sendv(c, iov, 3, res));
+  ASSERT_EQ(140, res);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(70, m_server_evt->receivedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_tcp->sendv(c, iov, 3, res));
+  ASSERT_EQ(200, res);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(60, m_server_evt->receivedLength());
+  ASSERT_TRUE(m_server_evt->dataWasPushed());
+  /*
+   * The whole message has been written.
+   */
+  ASSERT_EQ(Status::InvalidArgument, m_client_tcp->sendv(c, iov, 3, res));
+  /*
+   * Clean-up
+   */
+  delete[] pld;
+}
+
+TEST_F(TCP_NoDelay, ConnectSendTimestamps)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Both ends offer timestamps.
+   */
+  m_client_tcp->setTimestamps(true);
+  m_server_tcp->setTimestamps(true);
+  /*
+   * Client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * Client sends a payload, the segment is shortened by the options.
+   */
+  uint32_t res = 0;
+  auto* pld = new uint8_t[200];
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 200, pld, res));
+  ASSERT_EQ(58, res);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(58, m_server_evt->receivedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(0, m_server_tcp->statistics().paws);
+  /*
+   * Move the clock backward: the next segment looks like an old duplicate and
+   * is rejected by the server, as is the ACK of the server by the client.
+   */
+  system::Clock::get().offsetBy(-CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 200, pld, res));
+  ASSERT_EQ(116, res);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(1, m_server_tcp->statistics().paws);
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  /*
+   * The retransmission carries a fresh timestamp and is accepted.
+   */
+  system::Clock::get().offsetBy(2 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(58, m_server_evt->receivedLength());
+  ASSERT_EQ(1, m_server_tcp->statistics().paws);
+  /*
+   * Clean-up
+   */
+  delete[] pld;
+}
+
+TEST_F(TCP_NoDelay, ConnectSendDelayedAck)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * Put the server in delayed ACK mode.
+   */
+  m_server_evt->setDelayedAck();
+  /*
+   * Client connects
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+  /*
+   * Client sends three segments in a row.
+   */
+  uint32_t res = 0;
+  auto* pld = new uint8_t[210];
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 210, pld, res));
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 210, pld, res));
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 210, pld, res));
+  ASSERT_EQ(210, res);
+  /*
+   * The server delays the ACK of the first segment.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client_eth_proc));
+  /*
+   * The server acknowledges the second segment right away.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client_eth_proc));
+  /*
+   * The server delays the ACK of the third segment until it runs.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_tcp->run());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(1, m_server_tcp->statistics().delack);
+  /*
+   * Nothing is left to acknowledge.
+   */
+  ASSERT_EQ(Status::Ok, m_server_tcp->run());
+  ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(1, m_server_tcp->statistics().delack);
+  /*
+   * Clean-up
+   */
+  delete[] pld;
+}
@@ -25,17 +25,23 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <tulips/stack/tcpv4/Options.h>
 #include <tulips/stack/tcpv4/Processor.h>
+#include <tulips/stack/Utils.h>
 #include <tulips/stack/ipv4/Producer.h>
 #include <tulips/stack/ipv4/Processor.h>
 #include <tulips/stack/ethernet/Producer.h>
 #include <tulips/stack/ethernet/Processor.h>
 #include <tulips/system/Compiler.h>
+#include <tulips/transport/list/Device.h>
 #include <tulips/transport/pcap/Device.h>
 #include <tulips/transport/shm/Device.h>
 #include <tulips/transport/Processor.h>
 #include <gtest/gtest.h>
 #include <fstream>
+#include <iterator>
+#include <vector>
+#include <arpa/inet.h>
 
 using namespace tulips;
 using namespace stack;
@@ -45,6 +51,8 @@ namespace {
 class Client : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Client(std::string const& fn) : m_out(), m_connected(false)
   {
     m_out.open(fn.c_str());
@@ -120,6 +128,8 @@ private:
 class Server : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Server(std::string const& fn)
     : m_out(), m_connected(false), m_cid(-1), m_rlen(0)
   {
@@ -193,6 +203,8 @@ public:
 
   bool isConnected() const { return m_connected; }
 
+  uint32_t receivedLength() const { return m_rlen; }
+
 private:
   std::ofstream m_out;
   bool m_connected;
@@ -273,7 +285,7 @@ protected:
     m_client_eth_proc = new ethernet::Processor(m_client_pcap->address());
     m_client_ip4_proc = new ipv4::Processor(m_client_ip4);
     m_client_tcp = new tcpv4::Processor(*m_client_pcap, *m_client_eth_prod,
-                                        *m_client_ip4_prod, *m_client_evt, 1);
+                                        *m_client_ip4_prod, *m_client_evt, 2);
     /*
      * Client processor binding
      */
@@ -404,6 +416,33 @@ TEST_F(TCP_Rexmit, ConnectSynRetransmit)
   ASSERT_TRUE(m_server_evt->isConnected());
 }
 
+TEST_F(TCP_Rexmit, ConnectSynRetransmitInOnePass)
+{
+  tcpv4::Connection::ID c0, c1;
+  /*
+   * Server listens, client connects twice
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c0));
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c1));
+  /*
+   * Nothing is retransmitted before the timeout
+   */
+  system::Clock::get().offsetBy(2 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  /*
+   * Both SYNs are retransmitted by the same run
+   */
+  system::Clock::get().offsetBy(CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  ASSERT_EQ(Status::NoDataAvailable, m_server->drop());
+}
+
 TEST_F(TCP_Rexmit, ConnectSynAckRetransmit)
 {
   tcpv4::Connection::ID c;
@@ -435,6 +474,10 @@ TEST_F(TCP_Rexmit, ConnectSynAckRetransmit)
 TEST_F(TCP_Rexmit, ConnectSendRetransmit)
 {
   tcpv4::Connection::ID c;
+  /*
+   * Bound the client RTO to [1ms, 1s].
+   */
+  m_client_tcp->setRtoBounds(CLOCK_SECOND / 1000, CLOCK_SECOND);
   /*
    * Server listens, client connects
    */
@@ -453,18 +496,844 @@ TEST_F(TCP_Rexmit, ConnectSendRetransmit)
   ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
   ASSERT_EQ(8, res);
   /*
-   * Client retransmits after 3 seconds.
+   * The SYN/ACK gave the client an RTT measurement well below the minimum RTO,
+   * so it retransmits after 1ms.
    */
-  system::Clock::get().offsetBy(CLOCK_SECOND);
+  system::Clock::get().offsetBy(CLOCK_SECOND / 1000);
   ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  /*
+   * Server drops the extra packet and responds.
+   */
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+}
+
+namespace {
+
+class NoDelayClient : public Client
+{
+public:
+  NoDelayClient(std::string const& fn)
+    : Client(fn), m_kaidle(0), m_kaintvl(0), m_kacnt(0)
+  {}
+
+  void onConnected(tcpv4::Connection& c) override
+  {
+    c.setOptions(tcpv4::Connection::NO_DELAY);
+    if (m_kaidle != 0) {
+      c.setOptions(tcpv4::Connection::KEEPALIVE, m_kaidle, m_kaintvl, m_kacnt);
+    }
+    Client::onConnected(c);
+  }
+
+  void setKeepAlive(const uint16_t idle, const uint16_t intvl,
+                    const uint8_t count)
+  {
+    m_kaidle = idle;
+    m_kaintvl = intvl;
+    m_kacnt = count;
+  }
+
+private:
+  uint16_t m_kaidle;
+  uint16_t m_kaintvl;
+  uint8_t m_kacnt;
+};
+
+} // namespace
+
+class TCP_FastRexmit : public ::testing::Test
+{
+public:
+  TCP_FastRexmit()
+    : m_client_list()
+    , m_server_list()
+    , m_dropped()
+    , m_client_adr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10)
+    , m_server_adr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20)
+    , m_bcast(10, 1, 0, 254)
+    , m_nmask(255, 255, 255, 0)
+    , m_client_ip4(10, 1, 0, 1)
+    , m_server_ip4(10, 1, 0, 2)
+    , m_client(nullptr)
+    , m_server(nullptr)
+    , m_client_pcap(nullptr)
+    , m_server_pcap(nullptr)
+    , m_client_evt(nullptr)
+    , m_client_ip4_prod(nullptr)
+    , m_client_ip4_proc(nullptr)
+    , m_client_tcp(nullptr)
+    , m_client_eth_prod(nullptr)
+    , m_client_eth_proc(nullptr)
+    , m_server_evt(nullptr)
+    , m_server_ip4_prod(nullptr)
+    , m_server_ip4_proc(nullptr)
+    , m_server_tcp(nullptr)
+    , m_server_eth_prod(nullptr)
+    , m_server_eth_proc(nullptr)
+  {}
+
+protected:
+  void SetUp() override
+  {
+    std::string tname(
+      ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    /*
+     * Build the devices. The client writes to the client list, the server to
+     * the server list.
+     */
+    m_client = new transport::list::Device(m_client_adr, m_client_ip4,
+                                           m_bcast, m_nmask, 1514,
+                                           m_server_list, m_client_list);
+    m_server = new transport::list::Device(m_server_adr, m_server_ip4,
+                                           m_bcast, m_nmask, 1514,
+                                           m_client_list, m_server_list);
+    /*
+     * Build the pcap device
+     */
+    std::string client_n = "tcp_fastrexmit.client." + tname;
+    std::string server_n = "tcp_fastrexmit.server." + tname;
+    m_client_pcap = new transport::pcap::Device(*m_client, client_n + ".pcap");
+    m_server_pcap = new transport::pcap::Device(*m_server, server_n + ".pcap");
+    /*
+     * Client stack
+     */
+    m_client_evt = new NoDelayClient(client_n + ".log");
+    m_client_eth_prod =
+      new ethernet::Producer(*m_client_pcap, m_client_pcap->address());
+    m_client_ip4_prod = new ipv4::Producer(*m_client_eth_prod, m_client_ip4);
+    m_client_eth_proc = new ethernet::Processor(m_client_pcap->address());
+    m_client_ip4_proc = new ipv4::Processor(m_client_ip4);
+    m_client_tcp = new tcpv4::Processor(*m_client_pcap, *m_client_eth_prod,
+                                        *m_client_ip4_prod, *m_client_evt, 1);
+    /*
+     * Client processor binding
+     */
+    (*m_client_tcp)
+      .setEthernetProcessor(*m_client_eth_proc)
+      .setIPv4Processor(*m_client_ip4_proc);
+    (*m_client_ip4_prod).setDefaultRouterAddress(m_bcast).setNetMask(m_nmask);
+    (*m_client_ip4_proc)
+      .setEthernetProcessor(*m_client_eth_proc)
+      .setTCPv4Processor(*m_client_tcp);
+    (*m_client_eth_proc).setIPv4Processor(*m_client_ip4_proc);
+    /*
+     * Server stack
+     */
+    m_server_evt = new Server(server_n + ".log");
+    m_server_eth_prod =
+      new ethernet::Producer(*m_server_pcap, m_server_pcap->address());
+    m_server_ip4_prod = new ipv4::Producer(*m_server_eth_prod, m_server_ip4);
+    m_server_eth_proc = new ethernet::Processor(m_server_pcap->address());
+    m_server_ip4_proc = new ipv4::Processor(m_server_ip4);
+    m_server_tcp = new tcpv4::Processor(*m_server_pcap, *m_server_eth_prod,
+                                        *m_server_ip4_prod, *m_server_evt, 1);
+    /*
+     * Server processor binding
+     */
+    (*m_server_tcp)
+      .setEthernetProcessor(*m_server_eth_proc)
+      .setIPv4Processor(*m_server_ip4_proc);
+    (*m_server_ip4_prod).setDefaultRouterAddress(m_bcast).setNetMask(m_nmask);
+    (*m_server_ip4_proc)
+      .setEthernetProcessor(*m_server_eth_proc)
+      .setTCPv4Processor(*m_server_tcp);
+    (*m_server_eth_proc).setIPv4Processor(*m_server_ip4_proc);
+    /*
+     * TCP server listens
+     */
+    m_server_tcp->listen(1234);
+  }
+
+  void TearDown() override
+  {
+    /*
+     * Delete client stack.
+     */
+    delete m_client_evt;
+    delete m_client_ip4_proc;
+    delete m_client_ip4_prod;
+    delete m_client_tcp;
+    delete m_client_eth_proc;
+    delete m_client_eth_prod;
+    /*
+     * Delete server stack.
+     */
+    delete m_server_evt;
+    delete m_server_ip4_proc;
+    delete m_server_ip4_prod;
+    delete m_server_tcp;
+    delete m_server_eth_proc;
+    delete m_server_eth_prod;
+    /*
+     * Delete the pcap wrappers;
+     */
+    delete m_client_pcap;
+    delete m_server_pcap;
+    /*
+     * Delete client and server.
+     */
+    delete m_client;
+    delete m_server;
+    /*
+     * Release the packets.
+     */
+    for (auto* p : m_client_list) {
+      transport::list::Device::Packet::release(p);
+    }
+    for (auto* p : m_server_list) {
+      transport::list::Device::Packet::release(p);
+    }
+    for (auto* p : m_dropped) {
+      transport::list::Device::Packet::release(p);
+    }
+  }
+
+  /*
+   * Drop the n-th packet sent by the client. The packet is kept around until
+   * the end of the test as the client may still retransmit from its buffer.
+   */
+  void dropClientPacket(const size_t n)
+  {
+    auto it = m_client_list.begin();
+    std::advance(it, n);
+    m_dropped.push_back(*it);
+    m_client_list.erase(it);
+  }
+
+  /*
+   * Get the TCP header of a packet.
+   */
+  static tcpv4::Header* header(transport::list::Device::Packet* p)
+  {
+    return (tcpv4::Header*)(p->data + ethernet::HEADER_LEN + ipv4::HEADER_LEN);
+  }
+
+  /*
+   * Check if the TCP header of a packet carries an option.
+   */
+  static bool hasOption(transport::list::Device::Packet* p, const uint8_t opt)
+  {
+    tcpv4::Header* hdr = header(p);
+    size_t len = (hdr->offset - 5) << 2;
+    for (size_t c = 0; c < len;) {
+      if (hdr->opts[c] == tcpv4::Options::END) {
+        break;
+      }
+      if (hdr->opts[c] == tcpv4::Options::NOOP) {
+        c += 1;
+        continue;
+      }
+      if (hdr->opts[c] == opt) {
+        return true;
+      }
+      c += hdr->opts[c + 1];
+    }
+    return false;
+  }
+
+  /*
+   * Add SACK blocks to the n-th packet sent by the server.
+   */
+  void addSackBlocks(const size_t n, std::vector<uint32_t> const& blocks)
+  {
+    using Packet = transport::list::Device::Packet;
+    auto it = m_server_list.begin();
+    std::advance(it, n);
+    Packet* p = *it;
+    /*
+     * Copy the headers of the packet.
+     */
+    const size_t hlen = ethernet::HEADER_LEN + ipv4::HEADER_LEN;
+    const size_t olen = 2 + 2 + blocks.size() * 4;
+    Packet* q = Packet::allocate(1514);
+    memcpy(q->data, p->data, hlen + tcpv4::HEADER_LEN);
+    q->len = p->len + olen;
+    /*
+     * Add the SACK option.
+     */
+    tcpv4::Header* tcp = header(q);
+    tcp->opts[0] = tcpv4::Options::NOOP;
+    tcp->opts[1] = tcpv4::Options::NOOP;
+    tcp->opts[2] = tcpv4::Options::SACK;
+    tcp->opts[3] = 2 + blocks.size() * 4;
+    for (size_t i = 0; i < blocks.size(); i += 1) {
+      *(uint32_t*)&tcp->opts[4 + i * 4] = htonl(blocks[i]);
+    }
+    tcp->offset = (tcpv4::HEADER_LEN + olen) >> 2;
+    /*
+     * Update the IP header and the checksums.
+     */
+    auto* ip = (ipv4::Header*)(q->data + ethernet::HEADER_LEN);
+    const uint16_t tlen = tcpv4::HEADER_LEN + olen;
+    ip->len = htons(ipv4::HEADER_LEN + tlen);
+    ip->ipchksum = 0;
+    ip->ipchksum = ~ipv4::checksum((uint8_t*)ip);
+    tcp->chksum = 0;
+    uint16_t sum = tlen + ipv4::PROTO_TCP;
+    sum = utils::checksum(sum, (uint8_t*)&ip->srcipaddr, 4);
+    sum = utils::checksum(sum, (uint8_t*)&ip->destipaddr, 4);
+    sum = utils::checksum(sum, (uint8_t*)tcp, tlen);
+    tcp->chksum = ~(sum == 0 ? 0xffff : htons(sum));
+    /*
+     * Replace the packet.
+     */
+    *it = q;
+    Packet::release(p);
+  }
+
+  /*
+   * Change the window advertised by the n-th packet sent by the server.
+   */
+  void setWindow(const size_t n, const uint16_t wnd)
+  {
+    auto it = m_server_list.begin();
+    std::advance(it, n);
+    auto* ip = (ipv4::Header*)((*it)->data + ethernet::HEADER_LEN);
+    tcpv4::Header* tcp = header(*it);
+    const uint16_t tlen = ntohs(ip->len) - ipv4::HEADER_LEN;
+    tcp->wnd = htons(wnd);
+    /*
+     * Update the TCP checksum.
+     */
+    tcp->chksum = 0;
+    uint16_t sum = tlen + ipv4::PROTO_TCP;
+    sum = utils::checksum(sum, (uint8_t*)&ip->srcipaddr, 4);
+    sum = utils::checksum(sum, (uint8_t*)&ip->destipaddr, 4);
+    sum = utils::checksum(sum, (uint8_t*)tcp, tlen);
+    tcp->chksum = ~(sum == 0 ? 0xffff : htons(sum));
+  }
+
+  /*
+   * Duplicate the n-th packet sent by the server, at the end of the list.
+   */
+  void duplicateServerPacket(const size_t n)
+  {
+    using Packet = transport::list::Device::Packet;
+    auto it = m_server_list.begin();
+    std::advance(it, n);
+    Packet* q = Packet::allocate(1514);
+    memcpy(q, *it, sizeof(Packet) + (*it)->len);
+    m_server_list.push_back(q);
+  }
+
+  /*
+   * Connect the client to the server.
+   */
+  void connect(tcpv4::Connection::ID& c)
+  {
+    ASSERT_EQ(Status::Ok,
+              m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+    ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+    ASSERT_TRUE(m_client_evt->isConnected());
+    ASSERT_TRUE(m_server_evt->isConnected());
+    /*
+     * Exchange a first segment so that the client learns the window the
+     * server advertises outside of the handshake.
+     */
+    send(c, 1);
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+    ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  }
+
+  /*
+   * Send a number of segments from the client to the server.
+   */
+  void send(tcpv4::Connection::ID const& c, const size_t count)
+  {
+    uint64_t pld = 0xdeadbeefULL;
+    for (size_t i = 0; i < count; i += 1) {
+      uint32_t res = 0;
+      ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
+      ASSERT_EQ(8, res);
+    }
+    ASSERT_EQ(count, m_client_list.size());
+  }
+
+  transport::list::Device::List m_client_list;
+  transport::list::Device::List m_server_list;
+  std::vector<transport::list::Device::Packet*> m_dropped;
+  ethernet::Address m_client_adr;
+  ethernet::Address m_server_adr;
+  ipv4::Address m_bcast;
+  ipv4::Address m_nmask;
+  ipv4::Address m_client_ip4;
+  ipv4::Address m_server_ip4;
+  transport::list::Device* m_client;
+  transport::list::Device* m_server;
+  transport::pcap::Device* m_client_pcap;
+  transport::pcap::Device* m_server_pcap;
+  NoDelayClient* m_client_evt;
+  ipv4::Producer* m_client_ip4_prod;
+  ipv4::Processor* m_client_ip4_proc;
+  tcpv4::Processor* m_client_tcp;
+  ethernet::Producer* m_client_eth_prod;
+  ethernet::Processor* m_client_eth_proc;
+  Server* m_server_evt;
+  ipv4::Producer* m_server_ip4_prod;
+  ipv4::Processor* m_server_ip4_proc;
+  tcpv4::Processor* m_server_tcp;
+  ethernet::Producer* m_server_eth_prod;
+  ethernet::Processor* m_server_eth_proc;
+};
+
+TEST_F(TCP_FastRexmit, RetransmitOnThirdDupAck)
+{
+  tcpv4::Connection::ID c;
+  bool res = false;
+  connect(c);
+  /*
+   * The client sends 5 segments, the first and the third ones are lost.
+   */
+  send(c, 5);
+  dropClientPacket(2);
+  dropClientPacket(0);
+  /*
+   * The server queues the out-of-order segments and sends a duplicate ACK for
+   * each one of them.
+   */
+  for (size_t i = 0; i < 3; i += 1) {
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  }
+  ASSERT_EQ(3, m_server_list.size());
+  ASSERT_EQ(3, m_server_tcp->statistics().ooohit);
+  ASSERT_EQ(3, m_server_tcp->statistics().ooodep);
+  /*
+   * The client retransmits on the third duplicate ACK only.
+   */
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_TRUE(m_client_list.empty());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(1, m_client_list.size());
+  /*
+   * The server delivers the first two segments in one batch. The partial ACK
+   * triggers the retransmission of the next missing segment, without waiting
+   * for the retransmission timer.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(16, m_server_evt->receivedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(1, m_client_list.size());
+  /*
+   * The server delivers the last three segments in one batch. The ACK
+   * acknowledges everything and ends the recovery.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(24, m_server_evt->receivedLength());
+  ASSERT_EQ(0, m_server_tcp->statistics().ooodep);
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_TRUE(m_client_list.empty());
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, res));
+  ASSERT_FALSE(res);
+}
+
+TEST_F(TCP_FastRexmit, RetransmitOnTimeoutBelowThreshold)
+{
+  tcpv4::Connection::ID c;
+  bool res = false;
+  connect(c);
+  /*
+   * The client sends 3 segments, the first one is lost.
+   */
+  send(c, 3);
+  dropClientPacket(0);
+  /*
+   * Two duplicate ACKs are not enough to trigger a fast retransmit.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_TRUE(m_client_list.empty());
+  /*
+   * The retransmission timer fires instead.
+   */
   system::Clock::get().offsetBy(CLOCK_SECOND);
   ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_list.size());
+  /*
+   * The server delivers all the segments and acknowledges everything.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(24, m_server_evt->receivedLength());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_TRUE(m_client_list.empty());
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, res));
+  ASSERT_FALSE(res);
+}
+
+TEST_F(TCP_FastRexmit, ReassemblyOverflow)
+{
+  tcpv4::Connection::ID c;
+  connect(c);
+  /*
+   * The client sends more segments than a connection may queue, the first one
+   * is lost.
+   */
+  send(c, tcpv4::OOO_DEPTH + 2);
+  dropClientPacket(0);
+  for (size_t i = 0; i < tcpv4::OOO_DEPTH + 1; i += 1) {
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  }
+  ASSERT_EQ(tcpv4::OOO_DEPTH, m_server_tcp->statistics().ooohit);
+  ASSERT_EQ(tcpv4::OOO_DEPTH, m_server_tcp->statistics().ooodep);
+  ASSERT_EQ(1, m_server_tcp->statistics().ooodrop);
+  /*
+   * The retransmission of the first segment delivers the queued ones.
+   */
+  for (size_t i = 0; i < tcpv4::OOO_DEPTH + 1; i += 1) {
+    ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  }
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ((tcpv4::OOO_DEPTH + 1) * 8, m_server_evt->receivedLength());
+  ASSERT_EQ(0, m_server_tcp->statistics().ooodep);
+}
+
+TEST_F(TCP_FastRexmit, ZeroWindowProbe)
+{
+  tcpv4::Connection::ID c;
+  uint64_t pld = 0xdeadbeefULL;
+  uint32_t res = 0;
+  connect(c);
+  /*
+   * The server acknowledges a segment with a zero window. The update that
+   * re-opens the window follows, and is lost.
+   */
+  send(c, 1);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(1, m_server_list.size());
+  duplicateServerPacket(0);
+  setWindow(0, 0);
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client->drop());
+  ASSERT_TRUE(m_server_list.empty());
+  /*
+   * The client cannot send anything.
+   */
+  ASSERT_EQ(Status::OperationInProgress,
+            m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
+  ASSERT_EQ(0, res);
+  ASSERT_TRUE(m_client_list.empty());
+  /*
+   * The persist timer fires and the client probes the window. The probe is
+   * lost as well.
+   */
   system::Clock::get().offsetBy(CLOCK_SECOND);
   ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_EQ(1, m_client_tcp->statistics().probe);
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  /*
+   * The next probe is backed off.
+   */
+  system::Clock::get().offsetBy(CLOCK_SECOND / 4);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_TRUE(m_client_list.empty());
+  system::Clock::get().offsetBy(CLOCK_SECOND / 4);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_EQ(2, m_client_tcp->statistics().probe);
   /*
-   * Server drops the extra packet and responds.
+   * The server responds with its current window, and the client can send.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(1, m_server_list.size());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
+  ASSERT_EQ(8, res);
+  ASSERT_EQ(1, m_client_list.size());
+  /*
+   * No more probe is sent.
+   */
+  system::Clock::get().offsetBy(10 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_TRUE(m_client_list.empty());
+  ASSERT_EQ(2, m_client_tcp->statistics().probe);
+}
+
+TEST_F(TCP_FastRexmit, ReceiveWindowFollowsConsumption)
+{
+  tcpv4::Connection::ID c;
+  uint64_t pld = 0xdeadbeefULL;
+  uint32_t res = 0;
+  /*
+   * The server window is not scaled and has room for 5 segments. Once the
+   * first one is received, its connection has room for the 4 left, that it
+   * consumes on its own terms.
    */
+  m_server_tcp->setReceiveWindow(40);
+  connect(c);
+  ASSERT_EQ(Status::InvalidArgument, m_server_tcp->consume(0, 8));
+  ASSERT_EQ(Status::Ok, m_server_tcp->setReceiveBuffer(0, 32));
+  send(c, 1);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(24, ntohs(header(m_server_list.front())->wnd));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  /*
+   * The window closes as the data comes in.
+   */
+  send(c, 3);
+  for (size_t i = 0; i < 3; i += 1) {
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  }
+  ASSERT_EQ(0, ntohs(header(m_server_list.back())->wnd));
+  for (size_t i = 0; i < 3; i += 1) {
+    ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  }
+  ASSERT_EQ(Status::OperationInProgress,
+            m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
+  /*
+   * Consuming a single segment does not open the window, as that would be
+   * silly. The second one does.
+   */
+  ASSERT_EQ(Status::Ok, m_server_tcp->consume(0, 8));
+  ASSERT_TRUE(m_server_list.empty());
+  ASSERT_EQ(Status::Ok, m_server_tcp->consume(0, 8));
+  ASSERT_EQ(1, m_server_list.size());
+  ASSERT_EQ(16, ntohs(header(m_server_list.front())->wnd));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  send(c, 2);
+}
+
+TEST_F(TCP_FastRexmit, ReceiveBufferKeepsAdvertisedWindow)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * The server advertises a larger window than the buffer it then sets.
+   */
+  m_server_tcp->setReceiveWindow(4096);
+  connect(c);
+  ASSERT_EQ(Status::Ok, m_server_tcp->setReceiveBuffer(0, 32));
+  /*
+   * The window is not shrunk: its right edge has not moved since the first
+   * segment.
+   */
+  send(c, 1);
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(4080, ntohs(header(m_server_list.front())->wnd));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+}
+
+TEST_F(TCP_FastRexmit, WindowUpdateKeepsPendingData)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * The server has room for 4 segments, that it consumes on its own terms.
+   */
+  m_server_tcp->setReceiveWindow(40);
+  connect(c);
+  ASSERT_EQ(Status::Ok, m_server_tcp->setReceiveBuffer(0, 32));
+  /*
+   * The client fills the window.
+   */
+  send(c, 4);
+  for (size_t i = 0; i < 4; i += 1) {
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  }
+  ASSERT_EQ(0, ntohs(header(m_server_list.back())->wnd));
+  for (size_t i = 0; i < 4; i += 1) {
+    ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  }
+  /*
+   * The server sends a segment, and holds the next one back until the first
+   * one is acknowledged.
+   */
+  uint64_t first = 0x0706050403020100ULL;
+  uint64_t second = 0x0f0e0d0c0b0a0908ULL;
+  uint32_t off = 0;
+  ASSERT_EQ(Status::Ok, m_server_tcp->send(0, 8, (uint8_t*)&first, off));
+  off = 0;
+  ASSERT_EQ(Status::Ok, m_server_tcp->send(0, 8, (uint8_t*)&second, off));
+  ASSERT_EQ(1, m_server_list.size());
+  /*
+   * The window update is sent on its own, and leaves the pending data alone.
+   */
+  ASSERT_EQ(Status::Ok, m_server_tcp->consume(0, 16));
+  ASSERT_EQ(2, m_server_list.size());
+  auto* ip = (ipv4::Header*)(m_server_list.back()->data + ethernet::HEADER_LEN);
+  ASSERT_EQ(ipv4::HEADER_LEN + tcpv4::HEADER_LEN, ntohs(ip->len));
+  ASSERT_EQ(16, ntohs(header(m_server_list.back())->wnd));
+  /*
+   * Once the first segment is acknowledged, the pending data goes out.
+   */
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(1, m_server_list.size());
+  auto* p = m_server_list.front();
+  ip = (ipv4::Header*)(p->data + ethernet::HEADER_LEN);
+  ASSERT_EQ(ipv4::HEADER_LEN + tcpv4::HEADER_LEN + 8, ntohs(ip->len));
+  const uint8_t* pld = (uint8_t*)header(p) + tcpv4::HEADER_LEN;
+  ASSERT_EQ(0, memcmp(pld, &second, 8));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+}
+
+TEST_F(TCP_FastRexmit, WindowUpdateWithDataInFlight)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * The server has room for 4 segments, that it consumes on its own terms.
+   */
+  m_server_tcp->setReceiveWindow(40);
+  connect(c);
+  ASSERT_EQ(Status::Ok, m_server_tcp->setReceiveBuffer(0, 32));
+  /*
+   * The client fills the window.
+   */
+  send(c, 4);
+  for (size_t i = 0; i < 4; i += 1) {
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  }
+  ASSERT_EQ(0, ntohs(header(m_server_list.back())->wnd));
+  for (size_t i = 0; i < 4; i += 1) {
+    ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  }
+  /*
+   * The server opens the window, and the client sends a segment.
+   */
+  ASSERT_EQ(Status::Ok, m_server_tcp->consume(0, 16));
+  ASSERT_EQ(16, ntohs(header(m_server_list.back())->wnd));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  send(c, 1);
+  /*
+   * The server opens the window further before the segment arrives. The
+   * client records the new window and does not retransmit the segment.
+   */
+  ASSERT_EQ(Status::Ok, m_server_tcp->consume(0, 16));
+  ASSERT_EQ(32, ntohs(header(m_server_list.back())->wnd));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_EQ(0, m_client_tcp->statistics().rexmit);
+  /*
+   * The segment is acknowledged.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  bool res = true;
+  ASSERT_EQ(Status::Ok, m_client_tcp->hasOutstandingSegments(c, res));
+  ASSERT_FALSE(res);
+}
+
+TEST_F(TCP_FastRexmit, KeepAliveReapsIdleConnection)
+{
+  tcpv4::Connection::ID c;
+  m_client_evt->setKeepAlive(10, 1, 2);
+  connect(c);
+  /*
+   * Nothing is sent before the connection has been idle long enough.
+   */
+  system::Clock::get().offsetBy(5 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_TRUE(m_client_list.empty());
+  /*
+   * The client probes the idle connection, and the server answers.
+   */
+  system::Clock::get().offsetBy(6 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(1, m_server_list.size());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  /*
+   * The answer restarts the idle period.
+   */
+  system::Clock::get().offsetBy(5 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_TRUE(m_client_list.empty());
+  /*
+   * The server goes away: the probes are lost, and the connection is reaped
+   * once the last one is unanswered.
+   */
+  system::Clock::get().offsetBy(6 * CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_EQ(Status::Ok, m_server->drop());
+  system::Clock::get().offsetBy(CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_list.size());
   ASSERT_EQ(Status::Ok, m_server->drop());
+  ASSERT_EQ(0, m_client_tcp->statistics().kadrop);
+  system::Clock::get().offsetBy(CLOCK_SECOND);
+  ASSERT_EQ(Status::Ok, m_client_eth_proc->run());
+  ASSERT_EQ(1, m_client_tcp->statistics().kadrop);
+  /*
+   * The RST reaches the server, and the connection slot can be reused.
+   */
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_FALSE(m_server_evt->isConnected());
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+}
+
+TEST_F(TCP_FastRexmit, SackPermittedInHandshake)
+{
+  tcpv4::Connection::ID c;
+  /*
+   * The client permits SACK in its SYN.
+   */
+  ASSERT_EQ(Status::Ok,
+            m_client_tcp->connect(m_server_adr, m_server_ip4, 1234, c));
+  ASSERT_EQ(1, m_client_list.size());
+  ASSERT_TRUE(hasOption(m_client_list.front(), tcpv4::Options::SAP));
+  /*
+   * The server permits SACK in its SYN/ACK in return.
+   */
   ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_EQ(1, m_server_list.size());
+  ASSERT_TRUE(hasOption(m_server_list.front(), tcpv4::Options::SAP));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  ASSERT_TRUE(m_client_evt->isConnected());
+  ASSERT_TRUE(m_server_evt->isConnected());
+}
+
+TEST_F(TCP_FastRexmit, SackRetransmitOnlyHoles)
+{
+  tcpv4::Connection::ID c;
+  uint32_t seq[6];
+  connect(c);
+  /*
+   * The client sends 6 segments, the first and the third ones are lost.
+   */
+  send(c, 6);
+  size_t n = 0;
+  for (auto* p : m_client_list) {
+    seq[n++] = ntohl(header(p)->seqno);
+  }
+  dropClientPacket(2);
+  dropClientPacket(0);
+  /*
+   * The server sends a duplicate ACK for each out-of-order segment. Add the
+   * SACK blocks a SACK-enabled receiver would have sent.
+   */
+  for (size_t i = 0; i < 4; i += 1) {
+    ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  }
+  ASSERT_EQ(4, m_server_list.size());
+  addSackBlocks(0, { seq[1], seq[2] });
+  addSackBlocks(1, { seq[3], seq[4], seq[1], seq[2] });
+  addSackBlocks(2, { seq[3], seq[5], seq[1], seq[2] });
+  addSackBlocks(3, { seq[3], seq[5] + 8, seq[1], seq[2] });
+  /*
+   * On the third duplicate ACK, the client only retransmits the two holes.
+   */
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_TRUE(m_client_list.empty());
+  ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(2, m_client_list.size());
+  ASSERT_EQ(seq[0], ntohl(header(m_client_list.front())->seqno));
+  ASSERT_EQ(seq[2], ntohl(header(m_client_list.back())->seqno));
+  /*
+   * The last duplicate ACK does not report any new hole.
+   */
   ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(2, m_client_list.size());
 }
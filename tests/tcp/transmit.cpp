@@ -45,6 +45,8 @@ namespace {
 class Client : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Client(std::string const& fn)
     : m_out(), m_connected(false), m_delayedack(false)
   {
@@ -124,6 +126,8 @@ private:
 class Server : public tcpv4::EventHandler
 {
 public:
+  using tcpv4::EventHandler::onNewData;
+
   Server(std::string const& fn, const bool response = false)
     : m_out()
     , m_response(response)
@@ -598,6 +602,11 @@ TEST_F(TCP_Transmit, ConnectSendDisconnectFromServerWithAckCombining)
   ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
   ASSERT_EQ(8, res);
   ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  /*
+   * The server delays its ACK until it runs.
+   */
+  ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_tcp->run());
   ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
   /*
    * The client sends some data, #2
@@ -723,6 +732,11 @@ TEST_F(TCP_Transmit, ConnectSendAbortFromServerWithAckCombining)
   ASSERT_EQ(Status::Ok, m_client_tcp->send(c, 8, (uint8_t*)&pld, res));
   ASSERT_EQ(8, res);
   ASSERT_EQ(Status::Ok, m_server_pcap->poll(*m_server_eth_proc));
+  /*
+   * The server delays its ACK until it runs.
+   */
+  ASSERT_EQ(Status::NoDataAvailable, m_client_pcap->poll(*m_client_eth_proc));
+  ASSERT_EQ(Status::Ok, m_server_tcp->run());
   ASSERT_EQ(Status::Ok, m_client_pcap->poll(*m_client_eth_proc));
   /*
    * The client sends some data, #2
@@ -27,6 +27,7 @@
 
 #include <tulips/stack/Ethernet.h>
 #include <tulips/system/Compiler.h>
+#include <tulips/transport/pcap/Device.h>
 #include <tulips/transport/shm/Device.h>
 #include <tulips/transport/Processor.h>
 #include <gtest/gtest.h>
@@ -54,6 +55,8 @@ public:
     return Status::Ok;
   }
 
+  using transport::Processor::process;
+
   Status process(const uint16_t len, const uint8_t* const data) override
   {
     if (len == sizeof(m_value) && *(size_t*)data == m_value) {
@@ -85,6 +88,8 @@ public:
 
   Status run() override { return Status::Ok; }
 
+  using transport::Processor::process;
+
   Status process(const uint16_t UNUSED len, const uint8_t* const data) override
   {
     m_value = *(size_t*)data;
@@ -107,6 +112,31 @@ private:
   transport::Producer* m_prod;
 };
 
+class GatherProcessor : public transport::Processor
+{
+public:
+  GatherProcessor() : m_len(0), m_data() {}
+
+  Status run() override { return Status::Ok; }
+
+  using transport::Processor::process;
+
+  Status process(const uint16_t len, const uint8_t* const data) override
+  {
+    m_len = len;
+    memcpy(m_data, data, len);
+    return Status::Ok;
+  }
+
+  uint16_t length() const { return m_len; }
+
+  const uint8_t* data() const { return m_data; }
+
+private:
+  uint16_t m_len;
+  uint8_t m_data[64];
+};
+
 void*
 client_thread(void* arg)
 {
@@ -178,3 +208,53 @@ TEST(Transport_Basic, SharedMemory)
   tulips_fifo_destroy(&client_fifo);
   tulips_fifo_destroy(&server_fifo);
 }
+
+TEST(Transport_Basic, ScatterGather)
+{
+  tulips_fifo_t client_fifo = TULIPS_FIFO_DEFAULT_VALUE;
+  tulips_fifo_t server_fifo = TULIPS_FIFO_DEFAULT_VALUE;
+  /**
+   * Build the FIFOs
+   */
+  tulips_fifo_create(64, 128, &client_fifo);
+  tulips_fifo_create(64, 128, &server_fifo);
+  /**
+   * Build the devices
+   */
+  stack::ethernet::Address client_adr(0x10, 0x0, 0x0, 0x0, 0x10, 0x10);
+  stack::ethernet::Address server_adr(0x10, 0x0, 0x0, 0x0, 0x20, 0x20);
+  stack::ipv4::Address client_ip4(10, 1, 0, 1);
+  stack::ipv4::Address server_ip4(10, 1, 0, 2);
+  stack::ipv4::Address bcast(10, 1, 0, 254);
+  stack::ipv4::Address nmask(255, 255, 255, 0);
+  transport::shm::Device client(client_adr, client_ip4, bcast, nmask,
+                                server_fifo, client_fifo);
+  transport::shm::Device server(server_adr, server_ip4, bcast, nmask,
+                                client_fifo, server_fifo);
+  transport::pcap::Device client_pcap(client, "transport_basic_sg.pcap");
+  /**
+   * Commit a header followed by two fragments through the PCAP device.
+   */
+  const uint8_t hdr[4] = { 1, 2, 3, 4 };
+  const uint8_t frg0[3] = { 5, 6, 7 };
+  const uint8_t frg1[5] = { 8, 9, 10, 11, 12 };
+  transport::Frame frags[2] = { { 3, frg0 }, { 5, frg1 } };
+  uint8_t* data;
+  ASSERT_EQ(Status::Ok, client_pcap.prepare(data));
+  memcpy(data, hdr, sizeof(hdr));
+  ASSERT_EQ(Status::Ok, client_pcap.commitv(sizeof(hdr), data, 2, frags));
+  /**
+   * The server receives them as a single packet.
+   */
+  GatherProcessor proc;
+  ASSERT_EQ(Status::Ok, server.poll(proc));
+  ASSERT_EQ(12, proc.length());
+  for (uint8_t i = 0; i < 12; i += 1) {
+    ASSERT_EQ(i + 1, proc.data()[i]);
+  }
+  /**
+   * Destroy the FIFOs
+   */
+  tulips_fifo_destroy(&client_fifo);
+  tulips_fifo_destroy(&server_fifo);
+}